@@ -0,0 +1,76 @@
+#include "bit_coding.h"
+
+#include <stdexcept>
+
+namespace XORC
+{
+
+    size_t eliasGammaLength(uint64_t value)
+    {
+        return 2 * (63 - __builtin_clzll(value)) + 1;
+    }
+
+    void writeEliasGamma(uint64_t value, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        int n = 63 - __builtin_clzll(value);
+        for (int i = 0; i < n; ++i)
+        {
+            output_data[len_output_data++] = 0;
+        }
+        for (int i = n; i >= 0; --i)
+        {
+            output_data[len_output_data++] = (value >> i) & 1;
+        }
+    }
+
+    void writeVarint(std::string &output, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<char>(value));
+    }
+
+    uint64_t readVarint(std::string_view input, size_t &pos)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (pos >= input.size())
+            {
+                break;
+            }
+            unsigned char byte = input[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        throw std::runtime_error("Truncated varint.");
+    }
+
+    uint64_t readEliasGamma(const Bit_View &input_data, size_t &pos)
+    {
+        const size_t len_input_data = input_data.size();
+        int n = 0;
+        while (n <= 63 && pos < len_input_data && !input_data[pos])
+        {
+            ++n;
+            ++pos;
+        }
+        if (n > 63 || pos >= len_input_data || len_input_data - pos <= static_cast<size_t>(n))
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        uint64_t value = 0;
+        for (int i = 0; i <= n; ++i)
+        {
+            value = (value << 1) | input_data[pos++];
+        }
+        return value;
+    }
+
+}
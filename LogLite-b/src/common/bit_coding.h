@@ -0,0 +1,37 @@
+#ifndef BIT_CODING_H_
+#define BIT_CODING_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <boost/dynamic_bitset.hpp>
+
+#include "common/bit_view.h"
+#include "common/huge_pages.h"
+
+namespace XORC
+{
+
+    // Elias gamma code for value >= 1: floor(log2(value)) zero bits, then the value's bits from the top.
+    // Reading throws on a code that runs past the end of input_data.
+    void writeEliasGamma(uint64_t value, Output_Bitset &output_data, uint64_t &len_output_data);
+    uint64_t readEliasGamma(const Bit_View &input_data, size_t &pos);
+    size_t eliasGammaLength(uint64_t value);
+
+    // LEB128 varints, for the byte-oriented side files (window snapshots, time index).
+    void writeVarint(std::string &output, uint64_t value);
+    uint64_t readVarint(std::string_view input, size_t &pos);
+
+    inline uint64_t zigzagEncode(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t zigzagDecode(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+}
+
+#endif
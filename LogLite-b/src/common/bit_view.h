@@ -0,0 +1,55 @@
+#ifndef BIT_VIEW_H_
+#define BIT_VIEW_H_
+
+#include <cstdint>
+#include <cstddef>
+
+namespace XORC
+{
+
+    // Read-only view of a bit range laid out like boost::dynamic_bitset<> blocks
+    // (bit i lives in word i / 64 at position i % 64). Nothing is copied.
+    class Bit_View
+    {
+    private:
+        const uint64_t *words = nullptr;
+        size_t bit_offset = 0;
+        size_t num_bits = 0;
+
+    public:
+        Bit_View() {}
+        Bit_View(const uint64_t *words, size_t num_bits, size_t bit_offset = 0)
+            : words(words), bit_offset(bit_offset), num_bits(num_bits) {}
+
+        size_t size() const { return num_bits; }
+        bool empty() const { return num_bits == 0; }
+
+        bool operator[](size_t pos) const
+        {
+            pos += bit_offset;
+            return (words[pos >> 6] >> (pos & 63)) & 1;
+        }
+
+        // count <= 57 bits starting at pos, first bit in the lowest position.
+        uint64_t bits(size_t pos, unsigned count) const
+        {
+            pos += bit_offset;
+            const size_t word = pos >> 6;
+            const unsigned shift = pos & 63;
+            uint64_t value = words[word] >> shift;
+            if (shift + count > 64)
+            {
+                value |= words[word + 1] << (64 - shift);
+            }
+            return value & ((static_cast<uint64_t>(1) << count) - 1);
+        }
+
+        Bit_View subview(size_t pos, size_t count) const
+        {
+            return Bit_View(words, count, bit_offset + pos);
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "bitmask.h"
+
+#include <cstring>
+
+#include "common/bit_coding.h"
+
+namespace XORC
+{
+
+    static size_t countChanged(const std::string &input)
+    {
+        size_t changed = 0;
+        for (char c : input)
+        {
+            changed += c != '\0';
+        }
+        return changed;
+    }
+
+    size_t bitmaskEncodedLength(const std::string &input)
+    {
+        size_t changed = countChanged(input);
+        return eliasGammaLength(changed + 1) + input.size() + 8 * changed;
+    }
+
+    size_t bitmaskEncodeString(const std::string &input, Output_Bitset &output_data, uint64_t &len_output_data, std::string_view single_data)
+    {
+        const size_t len_begin = len_output_data;
+
+        writeEliasGamma(countChanged(input) + 1, output_data, len_output_data);
+        for (char c : input)
+        {
+            output_data[len_output_data++] = c != '\0';
+        }
+        for (size_t i = 0; i < input.size(); ++i)
+        {
+            if (input[i] != '\0')
+            {
+                for (int j = 0; j < 8; ++j)
+                {
+                    output_data[len_output_data++] = (single_data[i] >> j) & 1;
+                }
+            }
+        }
+
+        return len_output_data - len_begin;
+    }
+
+    size_t bitmaskLineLength(const Bit_View &single_data, size_t &pos, size_t &changed_count)
+    {
+        changed_count = readEliasGamma(single_data, pos) - 1;
+        if (single_data.size() - pos < 8 * changed_count)
+        {
+            throw std::runtime_error("Malformed bitmask record.");
+        }
+        return single_data.size() - pos - 8 * changed_count;
+    }
+
+    void bitmaskDecodeString(const Bit_View &single_data, size_t pos, size_t changed_count, const std::string &pattern,
+                             std::string &output_data, std::string &changed_bytes)
+    {
+        const size_t len_pattern = pattern.size();
+        output_data.resize(len_pattern);
+
+        // unpack the changed bytes first, padded so a full vector can always be loaded
+        size_t bytes_pos = pos + len_pattern;
+        changed_bytes.resize(changed_count + simd_width64);
+        size_t j = 0;
+        for (; j + 7 <= changed_count; j += 7)
+        {
+            uint64_t bytes = single_data.bits(bytes_pos + 8 * j, 56);
+            memcpy(&changed_bytes[j], &bytes, 7);
+        }
+        for (; j < changed_count; ++j)
+        {
+            changed_bytes[j] = single_data.bits(bytes_pos + 8 * j, 8);
+        }
+
+        size_t consumed = 0;
+        for (size_t i = 0; i < len_pattern; i += simd_width64)
+        {
+            const size_t n = std::min(simd_width64, len_pattern - i);
+            uint64_t mask = single_data.bits(pos + i, std::min<size_t>(n, 32));
+            if (n > 32)
+            {
+                mask |= single_data.bits(pos + i + 32, n - 32) << 32;
+            }
+
+#ifdef __AVX512VBMI2__
+            const __mmask64 lanes = n == simd_width64 ? ~0ULL : (1ULL << n) - 1;
+            __m512i pattern_vec = _mm512_maskz_loadu_epi8(lanes, pattern.data() + i);
+            __m512i changed_vec = _mm512_loadu_si512(changed_bytes.data() + consumed);
+            __m512i result_vec = _mm512_mask_expand_epi8(pattern_vec, mask, changed_vec);
+            _mm512_mask_storeu_epi8(&output_data[i], lanes, result_vec);
+            consumed += _mm_popcnt_u64(mask);
+#else
+            for (size_t k = 0; k < n; ++k)
+            {
+                output_data[i + k] = (mask >> k) & 1 ? changed_bytes[consumed++] : pattern[i + k];
+            }
+#endif
+        }
+    }
+
+}
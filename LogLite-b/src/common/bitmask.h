@@ -0,0 +1,30 @@
+#ifndef BITMASK_H_
+#define BITMASK_H_
+
+#include <string>
+#include <string_view>
+#include <boost/dynamic_bitset.hpp>
+#include <immintrin.h>
+
+#include "common/constants.h"
+#include "common/huge_pages.h"
+#include "common/bit_view.h"
+
+namespace XORC
+{
+
+    // XOR-bitmask payload: Elias gamma (changed count + 1), one bit per byte of the line (set where
+    // the XOR is non-zero), then the original value of each changed byte. The line length is not
+    // stored; the decoder derives it from the payload size.
+    size_t bitmaskEncodedLength(const std::string &input);
+    size_t bitmaskEncodeString(const std::string &input, Output_Bitset &output_data, uint64_t &len_output_data, std::string_view single_data);
+
+    // Reads the changed count at pos (advancing it) and returns the line length.
+    size_t bitmaskLineLength(const Bit_View &single_data, size_t &pos, size_t &changed_count);
+    // Rebuilds the line over pattern, with the mask starting at pos; changed_bytes is scratch.
+    void bitmaskDecodeString(const Bit_View &single_data, size_t pos, size_t changed_count, const std::string &pattern,
+                             std::string &output_data, std::string &changed_bytes);
+
+}
+
+#endif
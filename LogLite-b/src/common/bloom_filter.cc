@@ -0,0 +1,146 @@
+#include "bloom_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+
+#include "common/constants.h"
+
+namespace XORC
+{
+
+    // Probe j of a trigram is the top bits of h1 + j * h2 (double hashing); both hashes are 32-bit
+    // multiplicative, so the AVX2 build and the scalar lookup agree bit for bit.
+    constexpr uint32_t TRIGRAM_HASH_MULTIPLIER1 = 0x9E3779B1;
+    constexpr uint32_t TRIGRAM_HASH_MULTIPLIER2 = 0x85EBCA77;
+
+    // A trigram is the low 7 bits of its three bytes, so the set of them seen fits in L2; bytes
+    // folded together only add false positives.
+    constexpr int TRIGRAM_BITS = 21;
+
+    // Built from the bytes directly rather than rolled, so successive trigrams do not wait on each other.
+    static inline uint32_t trigramAt(const char *data)
+    {
+        return (static_cast<uint8_t>(data[0]) & 0x7F) | ((static_cast<uint8_t>(data[1]) & 0x7F) << 7) |
+               ((static_cast<uint8_t>(data[2]) & 0x7F) << 14);
+    }
+
+    static inline void setBit(std::string &filter, uint32_t position)
+    {
+        filter[1 + (position >> 3)] |= static_cast<char>(1 << (position & 7));
+    }
+
+    static inline bool testBit(std::string_view filter, uint32_t position)
+    {
+        return (static_cast<uint8_t>(filter[1 + (position >> 3)]) >> (position & 7)) & 1;
+    }
+
+    Trigram_Filter_Builder::Trigram_Filter_Builder() : seen((size_t(1) << TRIGRAM_BITS) / 64, 0)
+    {
+    }
+
+    void Trigram_Filter_Builder::add(std::string_view line)
+    {
+        uint64_t *seen = this->seen.data();
+        for (size_t i = 0; i + 2 < line.size(); ++i)
+        {
+            uint32_t trigram = trigramAt(&line[i]);
+            seen[trigram >> 6] |= uint64_t(1) << (trigram & 63);
+        }
+    }
+
+    void Trigram_Filter_Builder::collect()
+    {
+        this->trigrams.clear();
+        for (size_t i = 0; i < this->seen.size(); ++i)
+        {
+            for (uint64_t word = this->seen[i]; word != 0; word &= word - 1)
+            {
+                this->trigrams.push_back(static_cast<uint32_t>(i * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+    void Trigram_Filter_Builder::build(double false_positive_rate, std::string &filter)
+    {
+        this->collect();
+        // optimal size is -n ln p / ln^2 2 bits, rounded up to a power of two so a probe is a shift
+        size_t count = std::max<size_t>(this->trigrams.size(), 1);
+        double target_bits = -static_cast<double>(count) * std::log(false_positive_rate) / (M_LN2 * M_LN2);
+        int log_bits = 6;
+        while (log_bits < 32 && static_cast<double>(uint64_t(1) << log_bits) < target_bits)
+        {
+            ++log_bits;
+        }
+        uint64_t len_bits = uint64_t(1) << log_bits;
+        int probes = std::clamp<int>(std::lround(static_cast<double>(len_bits) / count * M_LN2), 1, TRIGRAM_FILTER_MAX_PROBES);
+        int shift = 32 - log_bits;
+
+        filter.assign(1 + len_bits / 8, 0);
+        filter[0] = static_cast<char>(probes);
+
+        size_t i = 0;
+        const __m256i multiplier1 = _mm256_set1_epi32(TRIGRAM_HASH_MULTIPLIER1);
+        const __m256i multiplier2 = _mm256_set1_epi32(TRIGRAM_HASH_MULTIPLIER2);
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m128i shift_count = _mm_cvtsi32_si128(shift);
+        alignas(32) uint32_t positions[8];
+        for (; i + 8 <= this->trigrams.size(); i += 8)
+        {
+            __m256i trigram = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&this->trigrams[i]));
+            __m256i h1 = _mm256_mullo_epi32(trigram, multiplier1);
+            __m256i h2 = _mm256_or_si256(_mm256_mullo_epi32(trigram, multiplier2), one);
+            for (int j = 0; j < probes; ++j)
+            {
+                _mm256_store_si256(reinterpret_cast<__m256i *>(positions), _mm256_srl_epi32(h1, shift_count));
+                for (uint32_t position : positions)
+                {
+                    setBit(filter, position);
+                }
+                h1 = _mm256_add_epi32(h1, h2);
+            }
+        }
+        for (; i < this->trigrams.size(); ++i)
+        {
+            uint32_t h1 = this->trigrams[i] * TRIGRAM_HASH_MULTIPLIER1;
+            uint32_t h2 = (this->trigrams[i] * TRIGRAM_HASH_MULTIPLIER2) | 1;
+            for (int j = 0; j < probes; ++j, h1 += h2)
+            {
+                setBit(filter, static_cast<uint32_t>(static_cast<uint64_t>(h1) >> shift));
+            }
+        }
+
+        std::fill(this->seen.begin(), this->seen.end(), 0);
+    }
+
+    bool trigramFilterMayContain(std::string_view filter, std::string_view text)
+    {
+        if (filter.size() < 9 || text.size() < 3)
+        {
+            return true;
+        }
+        size_t len_bits = (filter.size() - 1) * 8;
+        if ((len_bits & (len_bits - 1)) != 0)
+        {
+            return true;
+        }
+        int probes = static_cast<uint8_t>(filter[0]);
+        int shift = 32 - __builtin_ctzll(len_bits);
+
+        for (size_t i = 0; i + 2 < text.size(); ++i)
+        {
+            uint32_t trigram = trigramAt(&text[i]);
+            uint32_t h1 = trigram * TRIGRAM_HASH_MULTIPLIER1;
+            uint32_t h2 = (trigram * TRIGRAM_HASH_MULTIPLIER2) | 1;
+            for (int j = 0; j < probes; ++j, h1 += h2)
+            {
+                if (!testBit(filter, static_cast<uint32_t>(static_cast<uint64_t>(h1) >> shift)))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,38 @@
+#ifndef BLOOM_FILTER_H_
+#define BLOOM_FILTER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace XORC
+{
+
+    // Bloom filter over the byte trigrams of a span of lines: a line containing a literal of three
+    // bytes or more contains each of its trigrams, so one missing from the filter rules the span
+    // out. Serialized as the probe count (one byte) followed by a power-of-two bit array.
+    class Trigram_Filter_Builder
+    {
+    private:
+        std::vector<uint64_t> seen;     // one bit per possible trigram, set since the last build
+        std::vector<uint32_t> trigrams; // scratch for the set bits of seen
+
+        void collect();
+
+    public:
+        Trigram_Filter_Builder();
+
+        void add(std::string_view line);
+
+        // Writes a filter sized for false_positive_rate over the trigrams added so far, then starts over.
+        void build(double false_positive_rate, std::string &filter);
+    };
+
+    // False only when text cannot occur in a line of the filter's span. Texts shorter than a
+    // trigram and empty filters always pass.
+    bool trigramFilterMayContain(std::string_view filter, std::string_view text);
+
+}
+
+#endif
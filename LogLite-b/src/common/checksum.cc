@@ -0,0 +1,213 @@
+#include "checksum.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <immintrin.h>
+
+namespace XORC
+{
+
+    // reflected Castagnoli polynomial
+    static constexpr uint32_t CRC32C_POLYNOMIAL = 0x82f63b78;
+
+    // The three streams of crc32c each cover CRC32C_LONG (or, for the rest, CRC32C_SHORT) bytes
+    // and are joined by shifting a crc over that many zero bytes, one table lookup per crc byte.
+    static constexpr size_t CRC32C_LONG = 8192;
+    static constexpr size_t CRC32C_SHORT = 256;
+
+    static uint32_t gf2MatrixTimes(const uint32_t *matrix, uint32_t vector)
+    {
+        uint32_t sum = 0;
+        for (; vector != 0; vector >>= 1, ++matrix)
+        {
+            if (vector & 1)
+            {
+                sum ^= *matrix;
+            }
+        }
+        return sum;
+    }
+
+    static void gf2MatrixSquare(uint32_t *square, const uint32_t *matrix)
+    {
+        for (int n = 0; n < 32; ++n)
+        {
+            square[n] = gf2MatrixTimes(matrix, matrix[n]);
+        }
+    }
+
+    // Operator that appends len (a power of two) zero bytes to a crc.
+    static void zerosOperator(uint32_t *even, size_t len)
+    {
+        uint32_t odd[32];
+        odd[0] = CRC32C_POLYNOMIAL;
+        for (int n = 1; n < 32; ++n)
+        {
+            odd[n] = 1u << (n - 1);
+        }
+        gf2MatrixSquare(even, odd); // 2 zero bits
+        gf2MatrixSquare(odd, even); // 4 zero bits
+        for (;;)
+        {
+            gf2MatrixSquare(even, odd);
+            len >>= 1;
+            if (len == 0)
+            {
+                return;
+            }
+            gf2MatrixSquare(odd, even);
+            len >>= 1;
+            if (len == 0)
+            {
+                memcpy(even, odd, sizeof(odd));
+                return;
+            }
+        }
+    }
+
+    struct Crc32c_Shift
+    {
+        uint32_t table[4][256];
+
+        explicit Crc32c_Shift(size_t len)
+        {
+            uint32_t matrix[32];
+            zerosOperator(matrix, len);
+            for (uint32_t n = 0; n < 256; ++n)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    this->table[k][n] = gf2MatrixTimes(matrix, n << (8 * k));
+                }
+            }
+        }
+
+        uint32_t operator()(uint32_t crc) const
+        {
+            return this->table[0][crc & 0xff] ^ this->table[1][(crc >> 8) & 0xff] ^
+                   this->table[2][(crc >> 16) & 0xff] ^ this->table[3][crc >> 24];
+        }
+    };
+
+    static const Crc32c_Shift shift_long(CRC32C_LONG);
+    static const Crc32c_Shift shift_short(CRC32C_SHORT);
+
+    static inline uint64_t load64(const char *data)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        return word;
+    }
+
+    // crc0 continues over data[0, 3 * len); the other two streams start from 0 and are shifted in.
+    static inline uint64_t crc32cThreeWay(uint64_t crc0, const char *data, size_t len, const Crc32c_Shift &shift)
+    {
+        uint64_t crc1 = 0;
+        uint64_t crc2 = 0;
+        for (size_t i = 0; i < len; i += 8)
+        {
+            crc0 = _mm_crc32_u64(crc0, load64(data + i));
+            crc1 = _mm_crc32_u64(crc1, load64(data + len + i));
+            crc2 = _mm_crc32_u64(crc2, load64(data + 2 * len + i));
+        }
+        crc0 = shift(static_cast<uint32_t>(crc0)) ^ crc1;
+        return shift(static_cast<uint32_t>(crc0)) ^ crc2;
+    }
+
+    uint32_t crc32c(uint32_t crc, const char *data, size_t size)
+    {
+        uint64_t crc0 = ~crc;
+        while (size > 0 && reinterpret_cast<uintptr_t>(data) % 8 != 0)
+        {
+            crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+            --size;
+        }
+        for (; size >= 3 * CRC32C_LONG; data += 3 * CRC32C_LONG, size -= 3 * CRC32C_LONG)
+        {
+            crc0 = crc32cThreeWay(crc0, data, CRC32C_LONG, shift_long);
+        }
+        for (; size >= 3 * CRC32C_SHORT; data += 3 * CRC32C_SHORT, size -= 3 * CRC32C_SHORT)
+        {
+            crc0 = crc32cThreeWay(crc0, data, CRC32C_SHORT, shift_short);
+        }
+        for (; size >= 8; data += 8, size -= 8)
+        {
+            crc0 = _mm_crc32_u64(crc0, load64(data));
+        }
+        for (; size > 0; --size)
+        {
+            crc0 = _mm_crc32_u8(static_cast<uint32_t>(crc0), *data++);
+        }
+        return ~static_cast<uint32_t>(crc0);
+    }
+
+    void Chunk_Checksums::update(const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            size_t len_chunk_data = this->len_data % this->chunk_size;
+            size_t n = std::min(size, this->chunk_size - len_chunk_data);
+            this->crc = crc32c(this->crc, data, n);
+            this->len_data += n;
+            data += n;
+            size -= n;
+
+            if (len_chunk_data + n == this->chunk_size)
+            {
+                this->crcs.push_back(this->crc);
+                this->crc = 0;
+            }
+        }
+    }
+
+    // [crc32c of each chunk, uint32][chunk size][bytes covered][CHECKSUM_TRAILER_MAGIC], the
+    // last chunk possibly short.
+    void Chunk_Checksums::write_trailer(std::string &trailer) const
+    {
+        std::vector<uint32_t> crcs = this->crcs;
+        if (this->len_data % this->chunk_size != 0)
+        {
+            crcs.push_back(this->crc);
+        }
+        const uint64_t footer[3] = {this->chunk_size, this->len_data, CHECKSUM_TRAILER_MAGIC};
+        trailer.append(reinterpret_cast<const char *>(crcs.data()), crcs.size() * sizeof(uint32_t));
+        trailer.append(reinterpret_cast<const char *>(footer), sizeof(footer));
+    }
+
+    uint32_t Checksum_Trailer::chunk_crc(size_t chunk) const
+    {
+        uint32_t crc;
+        memcpy(&crc, this->crcs + chunk * sizeof(uint32_t), sizeof(crc));
+        return crc;
+    }
+
+    bool read_checksum_trailer(const char *data, size_t size, Checksum_Trailer &trailer)
+    {
+        uint64_t footer[3];
+        if (size < sizeof(footer))
+        {
+            return false;
+        }
+        memcpy(footer, data + size - sizeof(footer), sizeof(footer));
+        if (footer[2] != CHECKSUM_TRAILER_MAGIC)
+        {
+            return false;
+        }
+
+        trailer.chunk_size = footer[0];
+        trailer.len_data = footer[1];
+        if (trailer.chunk_size == 0 || trailer.len_data > size)
+        {
+            throw std::runtime_error("Malformed checksum trailer.");
+        }
+        size_t len_crcs = trailer.chunk_count() * sizeof(uint32_t);
+        if (trailer.len_data + len_crcs + sizeof(footer) != size)
+        {
+            throw std::runtime_error("Malformed checksum trailer.");
+        }
+        trailer.crcs = data + trailer.len_data;
+        return true;
+    }
+
+}
@@ -0,0 +1,52 @@
+#ifndef CHECKSUM_H_
+#define CHECKSUM_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "common/constants.h"
+
+namespace XORC
+{
+
+    // CRC32C (Castagnoli) with the SSE4.2 crc32 instruction, three independent streams at a time.
+    // Chains: crc32c(crc32c(0, a), b) == crc32c(0, a + b).
+    uint32_t crc32c(uint32_t crc, const char *data, size_t size);
+
+    // CRC32C of each consecutive chunk_size piece of a byte stream, fed in any split.
+    class Chunk_Checksums
+    {
+    private:
+        size_t chunk_size;
+        uint64_t len_data = 0;
+        uint32_t crc = 0;
+        std::vector<uint32_t> crcs;
+
+    public:
+        explicit Chunk_Checksums(size_t chunk_size = CHECKSUM_CHUNK_SIZE) : chunk_size(chunk_size) {}
+
+        void update(const char *data, size_t size);
+
+        // Appends the trailer covering everything updated so far, see CHECKSUM_TRAILER_MAGIC.
+        void write_trailer(std::string &trailer) const;
+    };
+
+    // A trailer found at the end of an archive. The checksums stay in the mapping.
+    struct Checksum_Trailer
+    {
+        uint64_t chunk_size = 0;
+        uint64_t len_data = 0; // everything before the trailer
+        const char *crcs = nullptr;
+
+        size_t chunk_count() const { return (len_data + chunk_size - 1) / chunk_size; }
+        uint32_t chunk_crc(size_t chunk) const;
+    };
+
+    // Returns false when data does not end in a checksum trailer; throws on a malformed one.
+    bool read_checksum_trailer(const char *data, size_t size, Checksum_Trailer &trailer);
+
+}
+
+#endif
@@ -2,6 +2,9 @@
 #ifndef CONSTANTS_H_
 #define CONSTANTS_H_
 
+#include <cstdint>
+#include <cstddef>
+
 // Parameters that can be adjusted
 constexpr int EACH_WINDOW_SIZE_COUNT = 3;
 constexpr int STREAM_ENCODER_COUNT = 13 + 8;
@@ -16,5 +19,139 @@ constexpr int RLE_SKIM = 8;
 constexpr int EACH_WINDOW_SIZE = 1 << EACH_WINDOW_SIZE_COUNT;
 constexpr size_t simd_width32 = 32;
 constexpr size_t simd_width16 = 16;
+constexpr size_t simd_width64 = 64;
+
+// Smallest byte range worth handing to its own line-indexing thread
+constexpr size_t LINE_INDEX_MIN_RANGE = static_cast<size_t>(16) << 20;
+
+// Line-length buckets reported by the compression statistics
+constexpr size_t STATS_LENGTH_BUCKET_COUNT = 16;
+
+// stream_compress_batch looks this many lines ahead and prefetches up to this many leading
+// bytes of each of their window candidates
+constexpr size_t BATCH_PREFETCH_DISTANCE = 4;
+constexpr size_t BATCH_PREFETCH_BYTES = 256;
+// Lines the CLI hands to stream_compress_batch at a time
+constexpr size_t COMPRESS_BATCH_LINES = 256;
+
+// Output is written in page-aligned chunks so it can go through O_DIRECT
+constexpr size_t OUTPUT_CHUNK_SIZE = static_cast<size_t>(4) << 20;
+
+// Huge pages (common/huge_pages.h): the x86-64 default size, and the smallest buffer worth
+// putting on them
+constexpr size_t HUGE_PAGE_SIZE = static_cast<size_t>(2) << 20;
+constexpr size_t HUGE_PAGE_MIN_BYTES = static_cast<size_t>(1) << 20;
+
+// Per-source output buffer of a Compressor_Group, kept small since there may be hundreds
+constexpr size_t GROUP_OUTPUT_CHUNK_SIZE = static_cast<size_t>(256) << 10;
+// Input is handed to a Compressor_Group in batches of about this many bytes (whole lines)
+constexpr size_t GROUP_BATCH_SIZE = static_cast<size_t>(1) << 20;
+
+// Follow mode reads in FOLLOW_READ_SIZE pieces, at most FOLLOW_MAX_READ per poll
+constexpr size_t FOLLOW_READ_SIZE = static_cast<size_t>(1) << 16;
+constexpr size_t FOLLOW_MAX_READ = static_cast<size_t>(4) << 20;
+
+// Ingest queue (common/ingest_queue.h): ring size, how long a producer spins on a full ring before
+// yielding, and how many lines the consumer compresses between releases or idle sleeps
+constexpr size_t INGEST_QUEUE_CAPACITY = static_cast<size_t>(8) << 20;
+constexpr unsigned INGEST_SPINS_BEFORE_YIELD = 1024;
+constexpr size_t INGEST_BATCH_LINES = 4096;
+constexpr int INGEST_IDLE_SLEEP_US = 100;
+
+// --estimate (compress/sample_estimator.h) reads about ESTIMATE_SAMPLE_FRACTION of the file in at
+// most ESTIMATE_SAMPLE_CHUNKS evenly spaced chunks; the first ESTIMATE_PRIME_SHARE of each chunk
+// only fills the window. ESTIMATE_CONFIDENCE_Z gives the 95% bounds once there are enough chunks.
+// The minimum chunk keeps files from about 40 MB up at ten or more chunks; smaller chunks prime
+// too little of the window and overestimate the ratio.
+constexpr double ESTIMATE_SAMPLE_FRACTION = 0.005;
+constexpr size_t ESTIMATE_SAMPLE_CHUNKS = 32;
+constexpr size_t ESTIMATE_MIN_CHUNK_SIZE = static_cast<size_t>(16) << 10;
+constexpr size_t ESTIMATE_MAX_CHUNK_SIZE = static_cast<size_t>(4) << 20;
+constexpr double ESTIMATE_PRIME_SHARE = 0.5;
+constexpr double ESTIMATE_CONFIDENCE_Z = 1.96;
+
+// Framed archives (follow mode) are a sequence of [magic][bit count][blocks] frames, each ending
+// on a record boundary, so readers can decode every complete frame while the writer appends.
+// The first byte has its low bit set, unlike a legacy stream's first raw record.
+constexpr uint64_t FRAME_MAGIC = 0x000000314643588B; // "\x8bXCF1"
+
+// With --checksums an archive ends in a trailer of CRC32C per CHECKSUM_CHUNK_SIZE bytes of it
+// (common/checksum.h), closed by this magic where a plain archive has its last_block_bits (<= 64)
+constexpr size_t CHECKSUM_CHUNK_SIZE = static_cast<size_t>(1) << 20;
+constexpr uint64_t CHECKSUM_TRAILER_MAGIC = 0x000000314B43588B; // "\x8bXCK1"
+
+// Optional stream header. Legacy streams always start with a raw record (bit 0 == 0),
+// so a header whose first bit is 1 can never be mistaken for one.
+constexpr uint32_t STREAM_HEADER_MAGIC = 0x43525889; // "\x89XRC" little-endian
+constexpr int STREAM_HEADER_MAGIC_COUNT = 32;
+constexpr uint32_t STREAM_HEADER_VERSION = 1;
+constexpr int STREAM_HEADER_VERSION_COUNT = 8;
+constexpr int STREAM_HEADER_FLAGS_COUNT = 24;
+
+constexpr uint32_t STREAM_FLAG_NUMERIC_DELTA = 1 << 0;
+// followed by the window budget in bytes, Elias gamma coded
+constexpr uint32_t STREAM_FLAG_WINDOW_BUDGET = 1 << 1;
+// Raw records may refill a known length, and an XOR payload may open with an empty run token
+// (1 + RLE_COUNT zero bits, never produced by the RLE encoder) to switch to the bitmask encoding
+constexpr uint32_t STREAM_FLAG_COST_MODEL = 1 << 2;
+// XOR payloads start with per-segment reference switches: gamma(count + 1), then per switch
+// gamma(segment gap) and the window id used from that segment on
+constexpr uint32_t STREAM_FLAG_SEGMENT_REFS = 1 << 3;
+// lines of MAX_LEN bytes or more are a raw header followed by one record per chunk
+constexpr uint32_t STREAM_FLAG_LONG_LINE_CHUNKS = 1 << 4;
+// records come in blocks of lines grouped by similarity; the header carries the block size
+// (Elias gamma, after the window budget) and each block starts with its line order
+constexpr uint32_t STREAM_FLAG_REORDER_BLOCKS = 1 << 5;
+constexpr uint32_t STREAM_FLAGS_KNOWN = STREAM_FLAG_NUMERIC_DELTA | STREAM_FLAG_WINDOW_BUDGET | STREAM_FLAG_COST_MODEL | STREAM_FLAG_SEGMENT_REFS |
+                                        STREAM_FLAG_LONG_LINE_CHUNKS | STREAM_FLAG_REORDER_BLOCKS;
+
+// Lines are split into SEGMENT_SIZE byte segments for per-segment references; switching to
+// another reference needs at least SEGMENT_SWITCH_MIN_GAIN more matching bytes in the segment
+constexpr size_t SEGMENT_SIZE = simd_width32;
+constexpr int SEGMENT_SWITCH_MIN_GAIN = 2;
+
+// Long lines are cut into LONG_LINE_CHUNK_SIZE chunks (the last one aligned to the end of the
+// line); each chunk index below LONG_LINE_WINDOW_CHUNKS has its own window bucket, later ones
+// share the last, so a window holds at most this many chunk buckets whatever the line length.
+constexpr size_t LONG_LINE_CHUNK_SIZE = 4096;
+constexpr size_t LONG_LINE_WINDOW_CHUNKS = 64;
+constexpr size_t LONG_LINE_KEY_BASE = size_t(1) << ORIGINAL_LENGTH_COUNT;
+// A long line header holds its length in ORIGINAL_LENGTH_COUNT bits; this value there means the
+// length follows, Elias gamma coded.
+constexpr size_t LONG_LINE_LENGTH_ESCAPE = (size_t(1) << ORIGINAL_LENGTH_COUNT) - 1;
+
+// Block reordering groups lines by length and a hash of their first REORDER_PREFIX_BYTES bytes
+// with digits masked, a cheap stand-in for the line's template.
+constexpr size_t REORDER_PREFIX_BYTES = 64;
+
+// The window is charged WINDOW_BUCKET_OVERHEAD bytes per length bucket and WINDOW_LINE_OVERHEAD
+// bytes per line on top of the line bytes, about what the containers and allocations holding
+// them cost. Fixed amounts, so that both ends of a stream evict alike.
+constexpr size_t WINDOW_BUCKET_OVERHEAD = 768;
+constexpr size_t WINDOW_LINE_OVERHEAD = 32;
+
+// Window snapshots (Stream_Compress::save_window), kept next to an archive for --append
+constexpr uint32_t WINDOW_SNAPSHOT_MAGIC = 0x31535758; // "XWS1"
+constexpr uint32_t WINDOW_SNAPSHOT_VERSION = 1;
+
+// Archive index (compress/archive_index.h), kept next to an archive compressed with a timestamp
+// format or trigram filters; a checkpoint with a window snapshot is taken every
+// ARCHIVE_INDEX_CHECKPOINT_LINES lines by default.
+constexpr uint32_t ARCHIVE_INDEX_MAGIC = 0x31495458; // "XTI1"
+constexpr uint32_t ARCHIVE_INDEX_VERSION = 1;
+constexpr uint32_t ARCHIVE_INDEX_TIME = 1;
+constexpr uint32_t ARCHIVE_INDEX_TRIGRAMS = 2;
+constexpr size_t ARCHIVE_INDEX_CHECKPOINT_LINES = static_cast<size_t>(1) << 16;
+
+// Trigram Bloom filters (common/bloom_filter.h) per checkpoint interval
+constexpr double TRIGRAM_FILTER_FALSE_POSITIVE_RATE = 0.01;
+constexpr int TRIGRAM_FILTER_MAX_PROBES = 16;
+
+// --summarize: families listed by line count, and lines per interval when there is no archive index
+constexpr size_t SUMMARY_TOP_FAMILIES = 20;
+constexpr size_t SUMMARY_INTERVAL_LINES = static_cast<size_t>(1) << 16;
+
+constexpr uint32_t NUMERIC_MAX_DECIMAL_DIGITS = 18;
+constexpr uint32_t NUMERIC_MAX_HEX_DIGITS = 15;
 
 #endif // CONSTANTS_H
\ No newline at end of file
@@ -1,9 +1,67 @@
 #include "file.h"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+
+#include "common/constants.h"
+#include "common/checksum.h"
+
 namespace XORC
 {
 
-    void write_bitset_to_file(const boost::dynamic_bitset<> &bitset, const char *filename)
+    Mapped_File::Mapped_File(const char *filename)
+    {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Failed to open file for reading.");
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to stat file.");
+        }
+
+        this->map_size = st.st_size;
+        if (this->map_size != 0)
+        {
+            void *addr = mmap(nullptr, this->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED)
+            {
+                close(fd);
+                throw std::runtime_error("Failed to map file.");
+            }
+            madvise(addr, this->map_size, MADV_SEQUENTIAL);
+            this->map_data = static_cast<const char *>(addr);
+        }
+        close(fd);
+    }
+
+    void Mapped_File::release(size_t offset)
+    {
+        size_t page_size = sysconf(_SC_PAGESIZE);
+        offset -= offset % page_size;
+        if (this->map_data != nullptr && offset > 0)
+        {
+            madvise(const_cast<char *>(this->map_data), std::min(offset, this->map_size), MADV_DONTNEED);
+        }
+    }
+
+    Mapped_File::~Mapped_File()
+    {
+        if (this->map_data != nullptr)
+        {
+            munmap(const_cast<char *>(this->map_data), this->map_size);
+        }
+    }
+
+    void write_bitset_to_file(const Output_Bitset &bitset, const char *filename)
     {
         std::ofstream file(filename, std::ios::binary);
         if (!file.is_open())
@@ -11,7 +69,7 @@ namespace XORC
             throw std::runtime_error("Failed to open file for writing.");
         }
 
-        std::vector<unsigned long> blocks(bitset.num_blocks());
+        Huge_Page_Vector<unsigned long> blocks(bitset.num_blocks());
         boost::to_block_range(bitset, blocks.begin());
 
         file.write(reinterpret_cast<const char *>(blocks.data()), blocks.size() * sizeof(unsigned long));
@@ -25,7 +83,7 @@ namespace XORC
         file.close();
     }
 
-    void read_bitset_from_file(boost::dynamic_bitset<> &bitset, const char *filename)
+    void read_bitset_from_file(Output_Bitset &bitset, const char *filename)
     {
         std::ifstream file(filename, std::ios::binary);
         if (!file.is_open())
@@ -43,7 +101,7 @@ namespace XORC
         file.seekg(0, std::ios::beg);
 
         size_t num_blocks = (file_size - sizeof(size_t)) / sizeof(unsigned long);
-        std::vector<unsigned long> blocks(num_blocks);
+        Huge_Page_Vector<unsigned long> blocks(num_blocks);
 
         file.read(reinterpret_cast<char *>(blocks.data()), blocks.size() * sizeof(unsigned long));
         file.close();
@@ -55,6 +113,72 @@ namespace XORC
         bitset.resize(bitset_size);
     }
 
+    Bit_View view_bitset_in_file(const Mapped_File &file)
+    {
+        // a checksum trailer follows last_block_bits
+        size_t size = file.size();
+        Checksum_Trailer trailer;
+        if (read_checksum_trailer(file.data(), size, trailer))
+        {
+            size = trailer.len_data;
+        }
+        if (size < sizeof(size_t) || (size - sizeof(size_t)) % sizeof(unsigned long) != 0)
+        {
+            throw std::runtime_error("Malformed compressed file.");
+        }
+
+        size_t last_block_bits;
+        memcpy(&last_block_bits, file.data() + size - sizeof(size_t), sizeof(size_t));
+
+        size_t num_blocks = (size - sizeof(size_t)) / sizeof(unsigned long);
+        if (num_blocks == 0)
+        {
+            return Bit_View();
+        }
+        if (last_block_bits == 0 || last_block_bits > sizeof(unsigned long) * 8)
+        {
+            throw std::runtime_error("Malformed compressed file.");
+        }
+
+        size_t bitset_size = (num_blocks - 1) * sizeof(unsigned long) * 8 + last_block_bits;
+        return Bit_View(reinterpret_cast<const uint64_t *>(file.data()), bitset_size);
+    }
+
+    bool is_framed_archive(const char *data, size_t size)
+    {
+        uint64_t magic;
+        if (size < sizeof(magic))
+        {
+            return false;
+        }
+        memcpy(&magic, data, sizeof(magic));
+        return magic == FRAME_MAGIC;
+    }
+
+    bool read_frame(const char *data, size_t size, size_t &offset, Bit_View &frame)
+    {
+        uint64_t header[2];
+        if (size - offset < sizeof(header))
+        {
+            return false;
+        }
+        memcpy(header, data + offset, sizeof(header));
+        if (header[0] != FRAME_MAGIC)
+        {
+            throw std::runtime_error("Malformed compressed file.");
+        }
+
+        size_t frame_bytes = (header[1] + 63) / 64 * sizeof(uint64_t);
+        if (size - offset - sizeof(header) < frame_bytes)
+        {
+            return false;
+        }
+
+        frame = Bit_View(reinterpret_cast<const uint64_t *>(data + offset + sizeof(header)), header[1]);
+        offset += sizeof(header) + frame_bytes;
+        return true;
+    }
+
     void write_string_to_file(const std::string &content, const char *filename)
     {
         std::ofstream file(filename, std::ios::out | std::ios::binary);
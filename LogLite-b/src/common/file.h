@@ -9,10 +9,43 @@
 #include <iostream>
 #include <boost/dynamic_bitset.hpp>
 
+#include "common/bit_view.h"
+#include "common/huge_pages.h"
+
 namespace XORC
 {
-    void write_bitset_to_file(const boost::dynamic_bitset<> &bitset, const char *filename);
-    void read_bitset_from_file(boost::dynamic_bitset<> &bitset, const char *filename);
+    // Read-only mapping of a whole file, advised for one sequential pass.
+    class Mapped_File
+    {
+    private:
+        const char *map_data = nullptr;
+        size_t map_size = 0;
+
+    public:
+        explicit Mapped_File(const char *filename);
+        ~Mapped_File();
+
+        Mapped_File(const Mapped_File &) = delete;
+        Mapped_File &operator=(const Mapped_File &) = delete;
+
+        const char *data() const { return map_data; }
+        size_t size() const { return map_size; }
+
+        // Drops the pages before offset from this mapping once they have been consumed.
+        void release(size_t offset);
+    };
+
+    void write_bitset_to_file(const Output_Bitset &bitset, const char *filename);
+    void read_bitset_from_file(Output_Bitset &bitset, const char *filename);
+    // Same layout as read_bitset_from_file, but the bits stay in the mapping. A checksum trailer
+    // (common/checksum.h) is skipped.
+    Bit_View view_bitset_in_file(const Mapped_File &file);
+
+    // Framed archives are written by follow mode, see FRAME_MAGIC.
+    bool is_framed_archive(const char *data, size_t size);
+    // Views the frame at offset and advances offset past it. Returns false at the end of the data or
+    // at a frame the writer has not finished yet.
+    bool read_frame(const char *data, size_t size, size_t &offset, Bit_View &frame);
 
     void write_string_to_file(const std::string &content, const char *filename);
     void read_string_from_file(std::string &content, const char *filename);
@@ -0,0 +1,205 @@
+#include "file_follower.h"
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "common/constants.h"
+#include "common/line_index.h"
+
+namespace XORC
+{
+
+    File_Follower::File_Follower(const char *path) : path(path)
+    {
+        size_t slash = this->path.rfind('/');
+        if (slash == std::string::npos)
+        {
+            this->directory = ".";
+        }
+        else
+        {
+            this->directory = slash == 0 ? "/" : this->path.substr(0, slash);
+        }
+
+        this->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (this->inotify_fd >= 0)
+        {
+            this->directory_watch = inotify_add_watch(this->inotify_fd, this->directory.c_str(), IN_CREATE | IN_MOVED_TO);
+        }
+
+        reopen();
+    }
+
+    File_Follower::~File_Follower()
+    {
+        if (this->fd >= 0)
+        {
+            close(this->fd);
+        }
+        if (this->inotify_fd >= 0)
+        {
+            close(this->inotify_fd);
+        }
+    }
+
+    bool File_Follower::reopen()
+    {
+        if (this->fd >= 0)
+        {
+            close(this->fd);
+            this->fd = -1;
+        }
+        if (this->file_watch >= 0)
+        {
+            inotify_rm_watch(this->inotify_fd, this->file_watch);
+            this->file_watch = -1;
+        }
+
+        this->fd = open(this->path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (this->fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        fstat(this->fd, &st);
+        this->file_dev = st.st_dev;
+        this->file_ino = st.st_ino;
+        this->file_offset = 0;
+
+        if (this->inotify_fd >= 0)
+        {
+            this->file_watch = inotify_add_watch(this->inotify_fd, this->path.c_str(),
+                                                 IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+        }
+        return true;
+    }
+
+    size_t File_Follower::read_available()
+    {
+        if (this->fd < 0)
+        {
+            return 0;
+        }
+
+        size_t total = 0;
+        while (total < FOLLOW_MAX_READ)
+        {
+            size_t old_size = this->buffer.size();
+            this->buffer.resize(old_size + FOLLOW_READ_SIZE);
+            ssize_t n = pread(this->fd, &this->buffer[old_size], FOLLOW_READ_SIZE, this->file_offset);
+            this->buffer.resize(old_size + (n > 0 ? n : 0));
+            if (n <= 0)
+            {
+                break;
+            }
+            this->file_offset += n;
+            total += n;
+        }
+        return total;
+    }
+
+    bool File_Follower::check_rotation()
+    {
+        bool changed = false;
+
+        struct stat st;
+        if (this->fd >= 0 && fstat(this->fd, &st) == 0 && st.st_size < this->file_offset)
+        {
+            this->file_offset = 0;
+            changed = true;
+        }
+        else if (stat(this->path.c_str(), &st) == 0 && (this->fd < 0 || st.st_ino != this->file_ino || st.st_dev != this->file_dev))
+        {
+            // anything written to the old file after the last read still belongs before the new one
+            while (read_available() > 0)
+            {
+            }
+            changed = reopen();
+        }
+
+        // a partial line from the old content must not be glued to the new content
+        if (changed && this->buffer.size() > this->consumed && this->buffer.back() != '\n')
+        {
+            this->buffer.push_back('\n');
+        }
+        return changed;
+    }
+
+    void File_Follower::wait_for_change(int timeout_ms)
+    {
+        if (this->inotify_fd < 0)
+        {
+            poll(nullptr, 0, timeout_ms);
+            return;
+        }
+
+        struct pollfd pfd = {this->inotify_fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) > 0)
+        {
+            char events[4096];
+            while (read(this->inotify_fd, events, sizeof(events)) > 0)
+            {
+            }
+        }
+    }
+
+    void File_Follower::poll_lines(int timeout_ms, std::vector<std::string_view> &lines)
+    {
+        lines.clear();
+        if (this->consumed > 0)
+        {
+            this->buffer.erase(0, this->consumed);
+            this->consumed = 0;
+        }
+
+        size_t scanned = this->buffer.size();
+        if (read_available() == 0)
+        {
+            if (!check_rotation())
+            {
+                wait_for_change(timeout_ms);
+                if (read_available() == 0 && check_rotation())
+                {
+                    read_available();
+                }
+            }
+            else
+            {
+                read_available();
+            }
+        }
+
+        // only the new bytes can hold newlines; the kept prefix is a partial line
+        std::vector<uint64_t> &positions = this->newlines;
+        positions.clear();
+        findNewlines(this->buffer.data(), scanned, this->buffer.size(), positions);
+
+        size_t start = 0;
+        for (uint64_t newline : positions)
+        {
+            size_t end = newline;
+            if (end > start && this->buffer[end - 1] == '\r')
+            {
+                --end;
+            }
+            lines.emplace_back(this->buffer.data() + start, end - start);
+            start = newline + 1;
+        }
+        this->consumed = start;
+    }
+
+    std::string_view File_Follower::partial_line() const
+    {
+        std::string_view partial(this->buffer.data() + this->consumed, this->buffer.size() - this->consumed);
+        if (!partial.empty() && partial.back() == '\r')
+        {
+            partial.remove_suffix(1);
+        }
+        return partial;
+    }
+
+}
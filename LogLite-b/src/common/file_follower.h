@@ -0,0 +1,57 @@
+#ifndef FILE_FOLLOWER_H_
+#define FILE_FOLLOWER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace XORC
+{
+
+    // Reads a growing log file from the start like tail -F: truncation restarts at offset 0, and
+    // when the path is renamed/removed and recreated the old file is drained before switching.
+    // Wake-ups come from inotify on the file and its directory, with a timed poll as fallback.
+    class File_Follower
+    {
+    private:
+        std::string path;
+        std::string directory;
+
+        int fd = -1;
+        dev_t file_dev = 0;
+        ino_t file_ino = 0;
+        off_t file_offset = 0;
+
+        int inotify_fd = -1;
+        int file_watch = -1;
+        int directory_watch = -1;
+
+        std::string buffer;
+        size_t consumed = 0;
+        std::vector<uint64_t> newlines;
+
+        bool reopen();
+        size_t read_available();
+        bool check_rotation();
+        void wait_for_change(int timeout_ms);
+
+    public:
+        explicit File_Follower(const char *path);
+        ~File_Follower();
+
+        File_Follower(const File_Follower &) = delete;
+        File_Follower &operator=(const File_Follower &) = delete;
+
+        // Waits up to timeout_ms for new data, then returns every complete line read so far
+        // (without '\n' / '\r\n'). The views stay valid until the next call.
+        void poll_lines(int timeout_ms, std::vector<std::string_view> &lines);
+
+        // Whatever follows the last newline; used to flush an unterminated last line on exit.
+        std::string_view partial_line() const;
+    };
+
+}
+
+#endif
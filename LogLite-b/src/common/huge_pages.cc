@@ -0,0 +1,196 @@
+#include "huge_pages.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <fstream>
+#include <string>
+
+namespace XORC
+{
+
+    struct Huge_Page_Region
+    {
+        size_t size;
+        Huge_Page_Kind kind;
+    };
+
+    static std::atomic<bool> huge_pages_enabled{false};
+
+    // every live allocation, so it can be freed the way it was made and reported on
+    static std::mutex regions_mutex;
+    static std::map<uintptr_t, Huge_Page_Region> regions;
+    static uint64_t allocation_count[HUGE_PAGE_KIND_COUNT] = {};
+    static uint64_t allocation_bytes[HUGE_PAGE_KIND_COUNT] = {};
+
+    static const char *kind_names[HUGE_PAGE_KIND_COUNT] = {"explicit (MAP_HUGETLB)", "transparent (MADV_HUGEPAGE)", "small pages"};
+
+    void setHugePages(bool enabled)
+    {
+        huge_pages_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool hugePagesEnabled()
+    {
+        return huge_pages_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void *mapAnonymous(size_t size, int flags)
+    {
+        void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+        return memory == MAP_FAILED ? nullptr : memory;
+    }
+
+    // Over-maps by one huge page and trims both ends, so the region starts on a huge page boundary
+    // and every HUGE_PAGE_SIZE of it can be backed by one.
+    static void *mapAlignedToHugePages(size_t size)
+    {
+        char *memory = static_cast<char *>(mapAnonymous(size + HUGE_PAGE_SIZE, 0));
+        if (memory == nullptr)
+        {
+            return nullptr;
+        }
+        size_t head = (HUGE_PAGE_SIZE - reinterpret_cast<uintptr_t>(memory) % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+        if (head > 0)
+        {
+            munmap(memory, head);
+        }
+        munmap(memory + head + size, HUGE_PAGE_SIZE - head);
+        return memory + head;
+    }
+
+    void *allocateHugePages(size_t size)
+    {
+        void *memory = nullptr;
+        Huge_Page_Kind kind = HUGE_PAGE_NONE;
+        // 0 for a heap allocation
+        size_t len_mapping = 0;
+        if (!hugePagesEnabled())
+        {
+            if (posix_memalign(&memory, sysconf(_SC_PAGESIZE), size) != 0)
+            {
+                throw std::bad_alloc();
+            }
+        }
+        else
+        {
+            // MAP_HUGETLB needs a multiple of the huge page size, and so does munmap of it
+            size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            len_mapping = size;
+            memory = mapAnonymous(size, MAP_HUGETLB);
+            if (memory != nullptr)
+            {
+                kind = HUGE_PAGE_EXPLICIT;
+            }
+            else
+            {
+                memory = mapAlignedToHugePages(size);
+                if (memory == nullptr)
+                {
+                    throw std::bad_alloc();
+                }
+                // fails where THP is compiled out or set to never; the mapping is still usable
+                if (madvise(memory, size, MADV_HUGEPAGE) == 0)
+                {
+                    kind = HUGE_PAGE_TRANSPARENT;
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(regions_mutex);
+        regions[reinterpret_cast<uintptr_t>(memory)] = {len_mapping, kind};
+        ++allocation_count[kind];
+        allocation_bytes[kind] += size;
+        return memory;
+    }
+
+    void freeHugePages(void *memory)
+    {
+        if (memory == nullptr)
+        {
+            return;
+        }
+        Huge_Page_Region region;
+        {
+            std::lock_guard<std::mutex> lock(regions_mutex);
+            auto position = regions.find(reinterpret_cast<uintptr_t>(memory));
+            region = position->second;
+            regions.erase(position);
+        }
+        if (region.size == 0)
+        {
+            free(memory);
+        }
+        else
+        {
+            munmap(memory, region.size);
+        }
+    }
+
+    // Sums AnonHugePages over the mappings that overlap a live transparent region.
+    static uint64_t transparentHugeBytes()
+    {
+        std::ifstream smaps("/proc/self/smaps");
+        std::string line;
+        bool is_region = false;
+        uint64_t huge_bytes = 0;
+        while (std::getline(smaps, line))
+        {
+            uintptr_t begin, end;
+            if (sscanf(line.c_str(), "%lx-%lx ", &begin, &end) == 2)
+            {
+                is_region = false;
+                auto position = regions.lower_bound(end);
+                while (position != regions.begin())
+                {
+                    --position;
+                    if (position->first + position->second.size <= begin)
+                    {
+                        break;
+                    }
+                    if (position->second.kind == HUGE_PAGE_TRANSPARENT)
+                    {
+                        is_region = true;
+                        break;
+                    }
+                }
+            }
+            else if (is_region && line.compare(0, 14, "AnonHugePages:") == 0)
+            {
+                huge_bytes += std::stoull(line.substr(14)) * 1024;
+            }
+        }
+        return huge_bytes;
+    }
+
+    void writeHugePageReport(std::ostream &os)
+    {
+        std::lock_guard<std::mutex> lock(regions_mutex);
+        os << "Huge pages " << (hugePagesEnabled() ? "enabled" : "disabled") << ":" << std::endl;
+        for (int kind = 0; kind < HUGE_PAGE_KIND_COUNT; ++kind)
+        {
+            os << "  " << kind_names[kind] << ": " << allocation_count[kind] << " buffers, "
+               << allocation_bytes[kind] / (1024.0 * 1024) << " MB" << std::endl;
+        }
+
+        uint64_t live_bytes = 0;
+        for (const auto &region : regions)
+        {
+            if (region.second.kind == HUGE_PAGE_TRANSPARENT)
+            {
+                live_bytes += region.second.size;
+            }
+        }
+        if (live_bytes > 0)
+        {
+            os << "  transparent now backed by huge pages: " << transparentHugeBytes() / (1024.0 * 1024) << " of "
+               << live_bytes / (1024.0 * 1024) << " MB" << std::endl;
+        }
+    }
+
+}
@@ -0,0 +1,87 @@
+#ifndef HUGE_PAGES_H_
+#define HUGE_PAGES_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+#include <vector>
+#include <boost/dynamic_bitset.hpp>
+
+#include "common/constants.h"
+
+namespace XORC
+{
+
+    // What backs an allocation of allocateHugePages.
+    enum Huge_Page_Kind : int
+    {
+        HUGE_PAGE_EXPLICIT,    // MAP_HUGETLB, from the reserved hugetlbfs pool
+        HUGE_PAGE_TRANSPARENT, // huge-page aligned and madvise(MADV_HUGEPAGE); the kernel may still use small pages
+        HUGE_PAGE_NONE,        // small pages: disabled, too small, or neither of the above was granted
+        HUGE_PAGE_KIND_COUNT
+    };
+
+    // Off by default. While off, allocateHugePages is a page-aligned heap allocation; buffers keep
+    // what they were allocated with when it is switched.
+    void setHugePages(bool enabled);
+    bool hugePagesEnabled();
+
+    // Page-aligned memory for a large buffer. Tries MAP_HUGETLB, then a HUGE_PAGE_SIZE aligned
+    // anonymous mapping advised MADV_HUGEPAGE, then small pages. Throws std::bad_alloc when no
+    // memory could be had at all.
+    void *allocateHugePages(size_t size);
+    void freeHugePages(void *memory);
+
+    // Allocations made by kind so far, and for the live transparent ones how much the kernel has
+    // actually backed with huge pages (AnonHugePages in /proc/self/smaps).
+    void writeHugePageReport(std::ostream &os);
+
+    // Containers that grow large get their storage from allocateHugePages; below
+    // HUGE_PAGE_MIN_BYTES it comes from the heap as usual.
+    template <typename T>
+    class Huge_Page_Allocator
+    {
+    public:
+        typedef T value_type;
+
+        Huge_Page_Allocator() {}
+        template <typename U>
+        Huge_Page_Allocator(const Huge_Page_Allocator<U> &) {}
+
+        T *allocate(size_t n)
+        {
+            if (n * sizeof(T) < HUGE_PAGE_MIN_BYTES)
+            {
+                return static_cast<T *>(::operator new(n * sizeof(T)));
+            }
+            return static_cast<T *>(allocateHugePages(n * sizeof(T)));
+        }
+
+        void deallocate(T *memory, size_t n)
+        {
+            if (n * sizeof(T) < HUGE_PAGE_MIN_BYTES)
+            {
+                ::operator delete(memory);
+            }
+            else
+            {
+                freeHugePages(memory);
+            }
+        }
+
+        template <typename U>
+        bool operator==(const Huge_Page_Allocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const Huge_Page_Allocator<U> &) const { return false; }
+    };
+
+    template <typename T>
+    using Huge_Page_Vector = std::vector<T, Huge_Page_Allocator<T>>;
+
+    // The compressed bitstream being written, same block layout as boost::dynamic_bitset<>.
+    typedef boost::dynamic_bitset<unsigned long, Huge_Page_Allocator<unsigned long>> Output_Bitset;
+
+}
+
+#endif
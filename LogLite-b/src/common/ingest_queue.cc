@@ -0,0 +1,160 @@
+#include "ingest_queue.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+#include <immintrin.h>
+
+#include "common/constants.h"
+
+namespace XORC
+{
+
+    static constexpr size_t RECORD_HEADER_SIZE = sizeof(uint64_t);
+
+    static size_t recordSize(size_t len_line)
+    {
+        return RECORD_HEADER_SIZE + ((len_line + RECORD_HEADER_SIZE - 1) & ~(RECORD_HEADER_SIZE - 1));
+    }
+
+    Ingest_Queue::Ingest_Queue(size_t capacity, Overflow_Policy overflow) : capacity(4096), overflow(overflow)
+    {
+        while (this->capacity < capacity)
+        {
+            this->capacity <<= 1;
+        }
+        void *memory = nullptr;
+        if (posix_memalign(&memory, 64, this->capacity) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        this->buffer = static_cast<char *>(memory);
+        memset(this->buffer, 0, this->capacity);
+    }
+
+    Ingest_Queue::~Ingest_Queue()
+    {
+        free(this->buffer);
+    }
+
+    bool Ingest_Queue::overflow_line(std::string_view line)
+    {
+        if (this->overflow == Overflow_Policy::DROP)
+        {
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(this->spill_mutex);
+        this->spill.emplace_back(line);
+        this->has_spill.store(true, std::memory_order_release);
+        this->spilled.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool Ingest_Queue::push(std::string_view line)
+    {
+        const size_t len_record = recordSize(line.size());
+        if (len_record > this->capacity)
+        {
+            return overflow_line(line);
+        }
+
+        uint64_t position = this->head.load(std::memory_order_relaxed);
+        unsigned spins = 0;
+        for (;;)
+        {
+            if (position + len_record - this->tail.load(std::memory_order_acquire) > this->capacity)
+            {
+                if (this->overflow != Overflow_Policy::BLOCK)
+                {
+                    return overflow_line(line);
+                }
+                // full: the only place a producer waits, backing off to yield after a while
+                if (++spins < INGEST_SPINS_BEFORE_YIELD)
+                {
+                    _mm_pause();
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+                position = this->head.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (this->head.compare_exchange_weak(position, position + len_record, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+
+        const size_t mask = this->capacity - 1;
+        size_t begin = (position + RECORD_HEADER_SIZE) & mask;
+        size_t first = std::min(line.size(), this->capacity - begin);
+        memcpy(this->buffer + begin, line.data(), first);
+        memcpy(this->buffer, line.data() + first, line.size() - first);
+        __atomic_store_n(reinterpret_cast<uint64_t *>(this->buffer + (position & mask)), line.size() + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    bool Ingest_Queue::pop(std::string_view &line, std::string &scratch)
+    {
+        if (this->read == this->head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        const size_t mask = this->capacity - 1;
+        uint64_t header = __atomic_load_n(reinterpret_cast<uint64_t *>(this->buffer + (this->read & mask)), __ATOMIC_ACQUIRE);
+        if (header == 0)
+        {
+            // reserved, still being copied
+            return false;
+        }
+
+        size_t len_line = header - 1;
+        size_t begin = (this->read + RECORD_HEADER_SIZE) & mask;
+        if (begin + len_line <= this->capacity)
+        {
+            line = std::string_view(this->buffer + begin, len_line);
+        }
+        else
+        {
+            size_t first = this->capacity - begin;
+            scratch.assign(this->buffer + begin, first);
+            scratch.append(this->buffer, len_line - first);
+            line = scratch;
+        }
+        this->read += recordSize(len_line);
+        return true;
+    }
+
+    void Ingest_Queue::release()
+    {
+        uint64_t position = this->tail.load(std::memory_order_relaxed);
+        if (position == this->read)
+        {
+            return;
+        }
+        const size_t mask = this->capacity - 1;
+        size_t begin = position & mask;
+        size_t len_released = this->read - position;
+        size_t first = std::min(len_released, this->capacity - begin);
+        memset(this->buffer + begin, 0, first);
+        memset(this->buffer, 0, len_released - first);
+        this->tail.store(this->read, std::memory_order_release);
+    }
+
+    bool Ingest_Queue::take_spill(std::vector<std::string> &lines)
+    {
+        if (!this->has_spill.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(this->spill_mutex);
+        lines.clear();
+        lines.swap(this->spill);
+        this->has_spill.store(false, std::memory_order_relaxed);
+        return !lines.empty();
+    }
+
+}
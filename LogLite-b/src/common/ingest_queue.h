@@ -0,0 +1,76 @@
+#ifndef INGEST_QUEUE_H_
+#define INGEST_QUEUE_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace XORC
+{
+
+    // What push does when the ring has no room: wait for the consumer, count the line as dropped,
+    // or move it to an unbounded locked overflow list the consumer drains after the ring.
+    enum class Overflow_Policy
+    {
+        BLOCK,
+        DROP,
+        SPILL
+    };
+
+    // Bounded multi-producer, single-consumer ring of lines. A producer reserves room with a CAS on
+    // head, copies the line and publishes it by storing its length + 1 in the record's 8-byte
+    // header; no lock or syscall is taken unless the ring is full. The consumer takes records in
+    // reservation order, stopping at the first one not yet published, and zeroes the room it
+    // releases so an unpublished header always reads 0.
+    //
+    // Lines that can never fit (record larger than the ring) overflow as if it were full, and block
+    // spills them. Spilled lines are compressed after the ring contents of the same drain, so their
+    // order against ring lines is not kept.
+    class Ingest_Queue
+    {
+    private:
+        char *buffer = nullptr;
+        size_t capacity;
+        Overflow_Policy overflow;
+
+        alignas(64) std::atomic<uint64_t> head{0}; // reserved by producers
+        alignas(64) std::atomic<uint64_t> tail{0}; // released by the consumer
+        alignas(64) uint64_t read = 0;             // consumer only: between tail and head
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> spilled{0};
+
+        std::mutex spill_mutex;
+        std::vector<std::string> spill;
+        std::atomic<bool> has_spill{false};
+
+        bool overflow_line(std::string_view line);
+
+    public:
+        // capacity is rounded up to a power of two of at least 4 KB.
+        Ingest_Queue(size_t capacity, Overflow_Policy overflow);
+        ~Ingest_Queue();
+
+        Ingest_Queue(const Ingest_Queue &) = delete;
+        Ingest_Queue &operator=(const Ingest_Queue &) = delete;
+
+        // Any thread. Returns false when the line was dropped.
+        bool push(std::string_view line);
+
+        // Consumer only. The view points into the ring (or into scratch for a record that wraps
+        // around its end) and stays valid until release().
+        bool pop(std::string_view &line, std::string &scratch);
+        // Consumer only: hands the room of every popped line back to the producers.
+        void release();
+        // Consumer only: moves the spilled lines out; false when there were none.
+        bool take_spill(std::vector<std::string> &lines);
+
+        uint64_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+        uint64_t get_spilled() const { return spilled.load(std::memory_order_relaxed); }
+    };
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+#include "line_index.h"
+
+namespace XORC
+{
+
+    void findNewlines(const char *data, size_t begin, size_t end, std::vector<uint64_t> &positions)
+    {
+        size_t i = begin;
+
+#if defined(__AVX512BW__)
+        const __m512i newline_vec64 = _mm512_set1_epi8('\n');
+        for (; i + simd_width64 <= end; i += simd_width64)
+        {
+            __m512i chunk = _mm512_loadu_si512(reinterpret_cast<const void *>(data + i));
+            uint64_t mask = _mm512_cmpeq_epi8_mask(chunk, newline_vec64);
+            while (mask)
+            {
+                positions.push_back(i + __builtin_ctzll(mask));
+                mask &= mask - 1;
+            }
+        }
+#endif
+
+        const __m256i newline_vec32 = _mm256_set1_epi8('\n');
+        for (; i + simd_width32 <= end; i += simd_width32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline_vec32));
+            while (mask)
+            {
+                positions.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+
+        for (; i < end; ++i)
+        {
+            if (data[i] == '\n')
+            {
+                positions.push_back(i);
+            }
+        }
+    }
+
+    void Line_Index::push_line(uint64_t start, uint64_t end)
+    {
+        // lengths are 32-bit to keep the table small; refuse rather than truncate
+        if (end - start > UINT32_MAX)
+        {
+            throw std::runtime_error("Lines of 4 GiB or more are not supported.");
+        }
+        this->offsets.push_back(start);
+        this->lengths.push_back(end - start);
+    }
+
+    void Line_Index::build(const char *data, size_t size, unsigned thread_count)
+    {
+        this->base = data;
+        this->offsets.clear();
+        this->lengths.clear();
+
+        if (thread_count == 0)
+        {
+            thread_count = 1;
+        }
+        if (size / thread_count < LINE_INDEX_MIN_RANGE)
+        {
+            thread_count = size / LINE_INDEX_MIN_RANGE > 0 ? size / LINE_INDEX_MIN_RANGE : 1;
+        }
+
+        std::vector<std::vector<uint64_t>> partial(thread_count);
+        if (thread_count == 1)
+        {
+            findNewlines(data, 0, size, partial[0]);
+        }
+        else
+        {
+            std::vector<std::thread> workers;
+            const size_t range = size / thread_count;
+            for (unsigned t = 0; t < thread_count; ++t)
+            {
+                size_t begin = t * range;
+                size_t end = t + 1 == thread_count ? size : begin + range;
+                workers.emplace_back(findNewlines, data, begin, end, std::ref(partial[t]));
+            }
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        size_t line_count = 0;
+        for (const auto &positions : partial)
+        {
+            line_count += positions.size();
+        }
+        this->offsets.reserve(line_count + 1);
+        this->lengths.reserve(line_count + 1);
+
+        uint64_t start = 0;
+        for (const auto &positions : partial)
+        {
+            for (uint64_t newline : positions)
+            {
+                uint64_t end = newline;
+                if (end > start && data[end - 1] == '\r')
+                {
+                    --end;
+                }
+                this->push_line(start, end);
+                start = newline + 1;
+            }
+        }
+
+        if (start < size)
+        {
+            uint64_t end = size;
+            if (data[end - 1] == '\r')
+            {
+                --end;
+            }
+            this->push_line(start, end);
+        }
+    }
+
+}
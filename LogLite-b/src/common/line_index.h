@@ -0,0 +1,43 @@
+#ifndef LINE_INDEX_H_
+#define LINE_INDEX_H_
+
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <cstdint>
+#include <immintrin.h>
+
+#include "common/constants.h"
+#include "common/huge_pages.h"
+
+namespace XORC
+{
+
+    // Appends the absolute position of every '\n' in data[begin, end) to positions.
+    void findNewlines(const char *data, size_t begin, size_t end, std::vector<uint64_t> &positions);
+
+    // Offset/length table of the lines in a buffer. Lengths exclude the '\n' and a '\r' before it,
+    // matching what std::getline plus the '\r' strip produced.
+    class Line_Index
+    {
+    private:
+        const char *base = nullptr;
+        Huge_Page_Vector<uint64_t> offsets;
+        Huge_Page_Vector<uint32_t> lengths;
+
+        void push_line(uint64_t start, uint64_t end);
+
+    public:
+        // Splits the buffer into thread_count ranges scanned in parallel, then stitches the results.
+        void build(const char *data, size_t size, unsigned thread_count = 1);
+
+        size_t size() const { return offsets.size(); }
+        uint64_t offset(size_t i) const { return offsets[i]; }
+        uint32_t length(size_t i) const { return lengths[i]; }
+        std::string_view line(size_t i) const { return std::string_view(base + offsets[i], lengths[i]); }
+    };
+
+}
+
+#endif
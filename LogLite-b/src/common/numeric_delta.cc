@@ -0,0 +1,349 @@
+#include "numeric_delta.h"
+
+namespace XORC
+{
+    static const char hex_lower_digits[] = "0123456789abcdef";
+    static const char hex_upper_digits[] = "0123456789ABCDEF";
+
+    static const int64_t pow10_table[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+    static inline bool isDecimal(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    static inline bool isHexChar(char c)
+    {
+        return isDecimal(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
+
+    static inline int twoDigits(const char *data)
+    {
+        return (data[0] - '0') * 10 + (data[1] - '0');
+    }
+
+    static bool matchClock(const std::string &reference, size_t i, Numeric_Field &field)
+    {
+        const size_t n = reference.size();
+        if (i + 8 > n)
+        {
+            return false;
+        }
+        const char *p = reference.data() + i;
+        if (!isDecimal(p[0]) || !isDecimal(p[1]) || p[2] != ':' || !isDecimal(p[3]) || !isDecimal(p[4]) ||
+            p[5] != ':' || !isDecimal(p[6]) || !isDecimal(p[7]) || twoDigits(p + 3) >= 60 || twoDigits(p + 6) >= 60)
+        {
+            return false;
+        }
+
+        field.start = i;
+        field.length = 8;
+        field.kind = NUMERIC_CLOCK;
+        field.frac_digits = 0;
+
+        size_t k = i + 8;
+        if (k < n && (reference[k] == '.' || reference[k] == ','))
+        {
+            size_t j = k + 1;
+            while (j < n && isDecimal(reference[j]))
+            {
+                ++j;
+            }
+            size_t frac_digits = j - k - 1;
+            if (frac_digits >= 1 && frac_digits <= 9 && (j == n || !isHexChar(reference[j])))
+            {
+                field.length = 9 + frac_digits;
+                field.frac_digits = frac_digits;
+            }
+        }
+        else if (k < n && isHexChar(reference[k]))
+        {
+            return false;
+        }
+        return true;
+    }
+
+    void findNumericFields(const std::string &reference, std::vector<Numeric_Field> &fields)
+    {
+        fields.clear();
+
+        const size_t n = reference.size();
+        size_t i = 0;
+        while (i < n)
+        {
+            if (!isHexChar(reference[i]))
+            {
+                ++i;
+                continue;
+            }
+
+            Numeric_Field field;
+            if (matchClock(reference, i, field))
+            {
+                fields.push_back(field);
+                i += field.length;
+                continue;
+            }
+
+            bool has_digit = false, has_lower = false, has_upper = false;
+            size_t j = i;
+            for (; j < n && isHexChar(reference[j]); ++j)
+            {
+                char c = reference[j];
+                has_digit |= isDecimal(c);
+                has_lower |= (c >= 'a' && c <= 'f');
+                has_upper |= (c >= 'A' && c <= 'F');
+            }
+
+            field.start = i;
+            field.length = j - i;
+            field.frac_digits = 0;
+            if (!has_lower && !has_upper)
+            {
+                if (field.length <= NUMERIC_MAX_DECIMAL_DIGITS)
+                {
+                    field.kind = NUMERIC_DECIMAL;
+                    fields.push_back(field);
+                }
+            }
+            else if (has_digit && !(has_lower && has_upper) && field.length <= NUMERIC_MAX_HEX_DIGITS)
+            {
+                field.kind = has_lower ? NUMERIC_HEX_LOWER : NUMERIC_HEX_UPPER;
+                fields.push_back(field);
+            }
+            i = j;
+        }
+    }
+
+    bool parseNumericField(const char *data, const Numeric_Field &field, int64_t &value)
+    {
+        value = 0;
+        switch (field.kind)
+        {
+        case NUMERIC_DECIMAL:
+            for (uint32_t k = 0; k < field.length; ++k)
+            {
+                if (!isDecimal(data[k]))
+                {
+                    return false;
+                }
+                value = value * 10 + (data[k] - '0');
+            }
+            return true;
+        case NUMERIC_HEX_LOWER:
+        case NUMERIC_HEX_UPPER:
+        {
+            const char letter = field.kind == NUMERIC_HEX_LOWER ? 'a' : 'A';
+            for (uint32_t k = 0; k < field.length; ++k)
+            {
+                char c = data[k];
+                if (isDecimal(c))
+                {
+                    value = (value << 4) | (c - '0');
+                }
+                else if (c >= letter && c <= letter + 5)
+                {
+                    value = (value << 4) | (c - letter + 10);
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        case NUMERIC_CLOCK:
+        {
+            if (!isDecimal(data[0]) || !isDecimal(data[1]) || !isDecimal(data[3]) || !isDecimal(data[4]) ||
+                !isDecimal(data[6]) || !isDecimal(data[7]))
+            {
+                return false;
+            }
+            int minutes = twoDigits(data + 3);
+            int seconds = twoDigits(data + 6);
+            if (minutes >= 60 || seconds >= 60)
+            {
+                return false;
+            }
+            value = (twoDigits(data) * 60 + minutes) * 60 + seconds;
+
+            int64_t frac = 0;
+            for (uint32_t k = 0; k < field.frac_digits; ++k)
+            {
+                if (!isDecimal(data[9 + k]))
+                {
+                    return false;
+                }
+                frac = frac * 10 + (data[9 + k] - '0');
+            }
+            value = value * pow10_table[field.frac_digits] + frac;
+            return true;
+        }
+        }
+        return false;
+    }
+
+    void formatNumericField(int64_t value, const Numeric_Field &field, char *data)
+    {
+        switch (field.kind)
+        {
+        case NUMERIC_DECIMAL:
+            for (int k = field.length - 1; k >= 0; --k)
+            {
+                data[k] = '0' + value % 10;
+                value /= 10;
+            }
+            break;
+        case NUMERIC_HEX_LOWER:
+        case NUMERIC_HEX_UPPER:
+        {
+            const char *digits = field.kind == NUMERIC_HEX_LOWER ? hex_lower_digits : hex_upper_digits;
+            for (int k = field.length - 1; k >= 0; --k)
+            {
+                data[k] = digits[value & 0xf];
+                value >>= 4;
+            }
+            break;
+        }
+        case NUMERIC_CLOCK:
+        {
+            int64_t frac = value % pow10_table[field.frac_digits];
+            value /= pow10_table[field.frac_digits];
+            for (int k = field.frac_digits - 1; k >= 0; --k)
+            {
+                data[9 + k] = '0' + frac % 10;
+                frac /= 10;
+            }
+            int seconds = value % 60;
+            value /= 60;
+            int minutes = value % 60;
+            int hours = value / 60;
+            data[0] = '0' + hours / 10;
+            data[1] = '0' + hours % 10;
+            data[3] = '0' + minutes / 10;
+            data[4] = '0' + minutes % 10;
+            data[6] = '0' + seconds / 10;
+            data[7] = '0' + seconds % 10;
+            break;
+        }
+        }
+    }
+
+    static bool clockSeparatorsMatch(const char *a, const char *b, const Numeric_Field &field)
+    {
+        return a[2] == b[2] && a[5] == b[5] && (field.frac_digits == 0 || a[8] == b[8]);
+    }
+
+    size_t numericDeltaEncode(std::string_view single_data, const std::string &reference, std::string &xor_result,
+                              Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        static thread_local std::vector<Numeric_Field> fields;
+        static thread_local std::vector<std::pair<uint32_t, uint64_t>> chosen;
+
+        findNumericFields(reference, fields);
+        chosen.clear();
+
+        int64_t prev_index = -1;
+        for (uint32_t index = 0; index < fields.size(); ++index)
+        {
+            const Numeric_Field &field = fields[index];
+
+            size_t changed = 0;
+            for (uint32_t k = 0; k < field.length; ++k)
+            {
+                changed += xor_result[field.start + k] != '\0';
+            }
+            if (changed == 0)
+            {
+                continue;
+            }
+
+            const char *line = single_data.data() + field.start;
+            const char *ref = reference.data() + field.start;
+            int64_t line_value, ref_value;
+            if (!parseNumericField(line, field, line_value) || !parseNumericField(ref, field, ref_value))
+            {
+                continue;
+            }
+            if (field.kind == NUMERIC_CLOCK && !clockSeparatorsMatch(line, ref, field))
+            {
+                continue;
+            }
+
+            uint64_t zigzag = zigzagEncode(line_value - ref_value);
+            size_t delta_bits = eliasGammaLength(index - prev_index) + eliasGammaLength(zigzag);
+            if (delta_bits >= changed * (RLE_SKIM + 1))
+            {
+                continue;
+            }
+
+            chosen.emplace_back(index, zigzag);
+            prev_index = index;
+        }
+
+        const uint64_t start = len_output_data;
+        if (chosen.empty())
+        {
+            output_data[len_output_data++] = 0;
+            return 1;
+        }
+
+        output_data[len_output_data++] = 1;
+        writeEliasGamma(chosen.size(), output_data, len_output_data);
+        prev_index = -1;
+        for (const auto &entry : chosen)
+        {
+            writeEliasGamma(entry.first - prev_index, output_data, len_output_data);
+            writeEliasGamma(entry.second, output_data, len_output_data);
+            prev_index = entry.first;
+
+            const Numeric_Field &field = fields[entry.first];
+            std::fill_n(&xor_result[field.start], field.length, '\0');
+        }
+
+        return len_output_data - start;
+    }
+
+    void numericDeltaRead(const Bit_View &input_data, size_t &pos, std::vector<std::pair<uint32_t, int64_t>> &deltas)
+    {
+        deltas.clear();
+        if (!input_data[pos++])
+        {
+            return;
+        }
+
+        uint64_t count = readEliasGamma(input_data, pos);
+        int64_t prev_index = -1;
+        for (uint64_t k = 0; k < count; ++k)
+        {
+            int64_t index = prev_index + readEliasGamma(input_data, pos);
+            int64_t delta = zigzagDecode(readEliasGamma(input_data, pos));
+            deltas.emplace_back(index, delta);
+            prev_index = index;
+        }
+    }
+
+    void numericDeltaApply(const std::string &reference, const std::vector<std::pair<uint32_t, int64_t>> &deltas, std::string &line)
+    {
+        if (deltas.empty())
+        {
+            return;
+        }
+
+        static thread_local std::vector<Numeric_Field> fields;
+        findNumericFields(reference, fields);
+
+        for (const auto &entry : deltas)
+        {
+            if (entry.first >= fields.size())
+            {
+                throw std::runtime_error("Numeric delta refers to a missing field.");
+            }
+            const Numeric_Field &field = fields[entry.first];
+            int64_t ref_value;
+            parseNumericField(reference.data() + field.start, field, ref_value);
+            formatNumericField(ref_value + entry.second, field, &line[field.start]);
+        }
+    }
+
+}
@@ -0,0 +1,52 @@
+#ifndef NUMERIC_DELTA_H_
+#define NUMERIC_DELTA_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/dynamic_bitset.hpp>
+
+#include "common/constants.h"
+#include "common/bit_coding.h"
+
+namespace XORC
+{
+
+    enum Numeric_Kind : uint8_t
+    {
+        NUMERIC_DECIMAL,
+        NUMERIC_HEX_LOWER,
+        NUMERIC_HEX_UPPER,
+        // hh:mm:ss with an optional .fff / ,fff fraction, valued as one number
+        NUMERIC_CLOCK
+    };
+
+    struct Numeric_Field
+    {
+        uint32_t start;
+        uint32_t length;
+        Numeric_Kind kind;
+        uint8_t frac_digits;
+    };
+
+    // Fields are found on the reference line only, so the decoder can rebuild the same list.
+    void findNumericFields(const std::string &reference, std::vector<Numeric_Field> &fields);
+
+    bool parseNumericField(const char *data, const Numeric_Field &field, int64_t &value);
+    void formatNumericField(int64_t value, const Numeric_Field &field, char *data);
+
+    // Zeroes the bytes of every field in xor_result that is cheaper to send as a delta against
+    // the reference, and writes the delta section (flag bit, then count / index gap / zigzag delta
+    // as Elias gamma). Returns the number of bits written.
+    size_t numericDeltaEncode(std::string_view single_data, const std::string &reference, std::string &xor_result,
+                              Output_Bitset &output_data, uint64_t &len_output_data);
+
+    // Reads the delta section at pos; deltas holds (field index, delta) pairs.
+    void numericDeltaRead(const Bit_View &input_data, size_t &pos, std::vector<std::pair<uint32_t, int64_t>> &deltas);
+    void numericDeltaApply(const std::string &reference, const std::vector<std::pair<uint32_t, int64_t>> &deltas, std::string &line);
+
+}
+
+#endif
@@ -0,0 +1,320 @@
+#include "output_sink.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+
+namespace XORC
+{
+
+    size_t takeCompleteBlocks(Output_Bitset &output_data, uint64_t &len_output_data, Huge_Page_Vector<unsigned long> &blocks)
+    {
+        const size_t bits_per_block = Output_Bitset::bits_per_block;
+        const size_t complete_blocks = len_output_data / bits_per_block;
+        const size_t len_tail = len_output_data % bits_per_block;
+
+        output_data.resize(len_output_data);
+        blocks.resize(output_data.num_blocks());
+        boost::to_block_range(output_data, blocks.begin());
+
+        output_data.clear();
+        if (len_tail > 0)
+        {
+            output_data.append(blocks[complete_blocks]);
+            output_data.resize(len_tail);
+        }
+        len_output_data = len_tail;
+        return complete_blocks;
+    }
+
+    unsigned long partialBlock(const Output_Bitset &output_data, uint64_t len_output_data)
+    {
+        unsigned long block = 0;
+        for (size_t i = 0; i < len_output_data; ++i)
+        {
+            block |= static_cast<unsigned long>(output_data[i]) << i;
+        }
+        return block;
+    }
+
+    Output_Sink::Output_Sink(const char *filename, bool direct_io, bool append, size_t chunk_size, bool synchronous)
+        : chunk_size(chunk_size), synchronous(synchronous)
+    {
+        // an appended file may be read back, see enable_checksums
+        const int flags = O_CREAT | (append ? O_RDWR : O_WRONLY | O_TRUNC);
+        if (direct_io && !append)
+        {
+            this->fd = open(filename, flags | O_DIRECT, 0644);
+            this->direct_io = this->fd >= 0;
+        }
+        if (this->fd < 0)
+        {
+            this->fd = open(filename, flags, 0644);
+        }
+        if (this->fd < 0)
+        {
+            throw std::runtime_error("Failed to open file for writing.");
+        }
+        if (append)
+        {
+            this->file_offset = lseek(this->fd, 0, SEEK_END);
+        }
+
+        // page aligned, which is all O_DIRECT needs
+        this->buffers[0] = static_cast<char *>(allocateHugePages(this->chunk_size));
+        if (synchronous)
+        {
+            return;
+        }
+        this->buffers[1] = static_cast<char *>(allocateHugePages(this->chunk_size));
+
+        this->writer = std::thread(&Output_Sink::writer_loop, this);
+    }
+
+    Output_Sink::~Output_Sink()
+    {
+        if (this->writer.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->stopping = true;
+            }
+            this->cv.notify_all();
+            this->writer.join();
+        }
+        for (char *buffer : this->buffers)
+        {
+            freeHugePages(buffer);
+        }
+        if (this->fd >= 0)
+        {
+            close(this->fd);
+        }
+    }
+
+    int Output_Sink::write_all(const char *data, size_t size)
+    {
+        if (this->checksums)
+        {
+            this->checksums->update(data, size);
+        }
+        while (size > 0)
+        {
+            ssize_t written = pwrite(this->fd, data, size, this->file_offset);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return errno;
+            }
+            data += written;
+            size -= written;
+            this->file_offset += written;
+        }
+        return 0;
+    }
+
+    void Output_Sink::writer_loop()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        while (true)
+        {
+            this->cv.wait(lock, [this]
+                          { return this->pending != nullptr || this->stopping; });
+            if (this->pending == nullptr)
+            {
+                return;
+            }
+
+            const char *data = this->pending;
+            size_t size = this->pending_size;
+            lock.unlock();
+
+            int error;
+            {
+                Scoped_Timer timer(TRACE_WRITE, size);
+                error = write_all(data, size);
+            }
+
+            lock.lock();
+            if (error != 0)
+            {
+                this->write_errno = error;
+            }
+            this->pending = nullptr;
+            this->cv.notify_all();
+        }
+    }
+
+    void Output_Sink::wait_idle()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->cv.wait(lock, [this]
+                      { return this->pending == nullptr; });
+        if (this->write_errno != 0)
+        {
+            throw std::runtime_error(std::string("Failed to write output: ") + strerror(this->write_errno));
+        }
+    }
+
+    void Output_Sink::write_now(const char *data, size_t size)
+    {
+        int error;
+        {
+            Scoped_Timer timer(TRACE_WRITE, size);
+            error = write_all(data, size);
+        }
+        if (error != 0)
+        {
+            throw std::runtime_error(std::string("Failed to write output: ") + strerror(error));
+        }
+    }
+
+    void Output_Sink::submit()
+    {
+        if (this->synchronous)
+        {
+            write_now(this->buffers[this->fill_index], this->fill_size);
+            this->fill_size = 0;
+            return;
+        }
+
+        wait_idle();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->pending = this->buffers[this->fill_index];
+            this->pending_size = this->fill_size;
+        }
+        this->cv.notify_all();
+
+        this->fill_index ^= 1;
+        this->fill_size = 0;
+    }
+
+    void Output_Sink::write(const char *data, size_t size)
+    {
+        while (size > 0)
+        {
+            size_t n = std::min(size, this->chunk_size - this->fill_size);
+            memcpy(this->buffers[this->fill_index] + this->fill_size, data, n);
+            this->fill_size += n;
+            data += n;
+            size -= n;
+
+            if (this->fill_size == this->chunk_size)
+            {
+                submit();
+            }
+        }
+    }
+
+    void Output_Sink::write_blocks(const unsigned long *blocks, size_t count)
+    {
+        write(reinterpret_cast<const char *>(blocks), count * sizeof(unsigned long));
+    }
+
+    void Output_Sink::drain(Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        if (len_output_data < Output_Bitset::bits_per_block)
+        {
+            return;
+        }
+
+        Scoped_Timer timer(TRACE_SERIALIZE, len_output_data / 8);
+        size_t complete_blocks = takeCompleteBlocks(output_data, len_output_data, this->drain_blocks);
+        write_blocks(this->drain_blocks.data(), complete_blocks);
+    }
+
+    void Output_Sink::enable_checksums()
+    {
+        this->checksums.reset(new Chunk_Checksums());
+        // the writer is idle until the first chunk, so its buffer can hold the existing contents
+        char *buffer = this->buffers[this->fill_index];
+        for (uint64_t offset = 0; offset < this->file_offset;)
+        {
+            ssize_t len_read = pread(this->fd, buffer, std::min<uint64_t>(this->chunk_size, this->file_offset - offset), offset);
+            if (len_read <= 0)
+            {
+                if (len_read < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::runtime_error("Failed to read the archive being appended to.");
+            }
+            this->checksums->update(buffer, len_read);
+            offset += len_read;
+        }
+    }
+
+    void Output_Sink::finish(Output_Bitset &output_data, uint64_t len_output_data, uint64_t total_bits)
+    {
+        const size_t bits_per_block = Output_Bitset::bits_per_block;
+
+        drain(output_data, len_output_data);
+        write_partial_block(output_data, len_output_data);
+
+        size_t last_block_bits = total_bits % bits_per_block;
+        if (last_block_bits == 0 && total_bits != 0)
+        {
+            last_block_bits = bits_per_block;
+        }
+        write(reinterpret_cast<const char *>(&last_block_bits), sizeof(size_t));
+
+        flush();
+        if (this->checksums)
+        {
+            // the trailer itself is not checksummed
+            std::unique_ptr<Chunk_Checksums> checksums = std::move(this->checksums);
+            std::string trailer;
+            checksums->write_trailer(trailer);
+            write(trailer.data(), trailer.size());
+            flush();
+        }
+    }
+
+    void Output_Sink::write_frame(Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        const uint64_t header[2] = {FRAME_MAGIC, len_output_data};
+        write(reinterpret_cast<const char *>(header), sizeof(header));
+
+        drain(output_data, len_output_data);
+        write_partial_block(output_data, len_output_data);
+        if (len_output_data > 0)
+        {
+            output_data.reset(0, len_output_data);
+        }
+        len_output_data = 0;
+
+        flush();
+    }
+
+    void Output_Sink::write_partial_block(Output_Bitset &output_data, uint64_t len_output_data)
+    {
+        if (len_output_data > 0)
+        {
+            unsigned long last_block = partialBlock(output_data, len_output_data);
+            write_blocks(&last_block, 1);
+        }
+    }
+
+    void Output_Sink::flush()
+    {
+        wait_idle();
+        if (this->fill_size > 0)
+        {
+            if (this->direct_io)
+            {
+                // the tail is unaligned, and so is every offset after it
+                fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) & ~O_DIRECT);
+                this->direct_io = false;
+            }
+            write_now(this->buffers[this->fill_index], this->fill_size);
+            this->fill_size = 0;
+        }
+    }
+
+}
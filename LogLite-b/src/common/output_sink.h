@@ -0,0 +1,105 @@
+#ifndef OUTPUT_SINK_H_
+#define OUTPUT_SINK_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <boost/dynamic_bitset.hpp>
+
+#include "common/constants.h"
+#include "common/huge_pages.h"
+#include "common/checksum.h"
+#include "common/trace.h"
+
+namespace XORC
+{
+
+    // Copies the complete leading blocks of output_data[0, len_output_data) to blocks and moves the
+    // partial block after them to the front, leaving output_data that long (it keeps its capacity,
+    // so writers grow it back without reallocating). Only the blocks in use are read. Returns the
+    // number of complete blocks.
+    size_t takeCompleteBlocks(Output_Bitset &output_data, uint64_t &len_output_data, Huge_Page_Vector<unsigned long> &blocks);
+
+    // output_data[0, len_output_data), fewer than a block of bits, as one block.
+    unsigned long partialBlock(const Output_Bitset &output_data, uint64_t len_output_data);
+
+    // Streams bitset blocks to a file in chunk_size pieces (OUTPUT_CHUNK_SIZE by default). Full
+    // chunks are handed to a background thread (double-buffered) so writing overlaps with
+    // compression; a synchronous sink writes them from the calling thread instead. finish() writes
+    // the same trailer as write_bitset_to_file, so the result reads back with read_bitset_from_file.
+    class Output_Sink
+    {
+    private:
+        int fd = -1;
+        bool direct_io = false;
+        uint64_t file_offset = 0;
+        size_t chunk_size;
+        bool synchronous;
+
+        char *buffers[2] = {nullptr, nullptr};
+        size_t fill_index = 0;
+        size_t fill_size = 0;
+
+        std::thread writer;
+        std::mutex mutex;
+        std::condition_variable cv;
+        char *pending = nullptr;
+        size_t pending_size = 0;
+        bool stopping = false;
+        int write_errno = 0;
+
+        Huge_Page_Vector<unsigned long> drain_blocks;
+        // fed by write_all, in file order
+        std::unique_ptr<Chunk_Checksums> checksums;
+
+        void writer_loop();
+        int write_all(const char *data, size_t size);
+        void write_now(const char *data, size_t size);
+        void submit();
+        void wait_idle();
+        void write_partial_block(Output_Bitset &output_data, uint64_t len_output_data);
+
+    public:
+        // direct_io asks for O_DIRECT and quietly falls back to buffered writes if refused.
+        // append keeps the file's contents and writes after them (always buffered).
+        // chunk_size must be a multiple of the page size. A synchronous sink has no writer thread
+        // and a single buffer, for callers that already write from a pool of their own.
+        Output_Sink(const char *filename, bool direct_io = false, bool append = false, size_t chunk_size = OUTPUT_CHUNK_SIZE,
+                    bool synchronous = false);
+        ~Output_Sink();
+
+        Output_Sink(const Output_Sink &) = delete;
+        Output_Sink &operator=(const Output_Sink &) = delete;
+
+        void write(const char *data, size_t size);
+        void write_blocks(const unsigned long *blocks, size_t count);
+
+        // Moves the complete leading blocks of output_data[0, len_output_data) into the sink, see
+        // takeCompleteBlocks.
+        void drain(Output_Bitset &output_data, uint64_t &len_output_data);
+
+        // Writes out everything buffered so far and waits for it to reach the file.
+        void flush();
+
+        // Checksums everything written from here on, and what an appended file already holds, into
+        // a trailer written by finish(). Call before the first write.
+        void enable_checksums();
+
+        // Writes the partial last block and the trailer, then flushes.
+        // total_bits is the length of the whole stream, including blocks already drained.
+        void finish(Output_Bitset &output_data, uint64_t len_output_data, uint64_t total_bits);
+
+        // Writes output_data[0, len_output_data) as one FRAME_MAGIC frame, resets len_output_data to 0
+        // and flushes, so a reader sees only whole frames. Not to be mixed with drain()/finish().
+        void write_frame(Output_Bitset &output_data, uint64_t &len_output_data);
+
+        bool is_direct_io() const { return direct_io; }
+    };
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <iomanip>
+
+namespace XORC
+{
+
+    static const char *event_names[PERF_EVENT_COUNT] = {
+        "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses", "dtlb_misses"};
+
+    static uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result)
+    {
+        return cache | (op << 8) | (result << 16);
+    }
+
+    static int openEvent(uint32_t type, uint64_t config)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    Perf_Counters::Perf_Counters()
+    {
+        const uint32_t types[PERF_EVENT_COUNT] = {
+            PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+            PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+        const uint64_t configs[PERF_EVENT_COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_BRANCH_MISSES,
+            cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+            cacheConfig(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+            cacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)};
+
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        {
+            this->fds[i] = openEvent(types[i], configs[i]);
+            if (this->fds[i] < 0 && this->open_errno == 0)
+            {
+                this->open_errno = errno;
+            }
+        }
+    }
+
+    Perf_Counters::~Perf_Counters()
+    {
+        for (int fd : this->fds)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+        }
+    }
+
+    bool Perf_Counters::any_available() const
+    {
+        for (int fd : this->fds)
+        {
+            if (fd >= 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Perf_Counters::start()
+    {
+        for (int fd : this->fds)
+        {
+            if (fd >= 0)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    void Perf_Counters::stop()
+    {
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        {
+            if (this->fds[i] < 0)
+            {
+                continue;
+            }
+            ioctl(this->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+
+            uint64_t data[3] = {0, 0, 0};
+            if (read(this->fds[i], data, sizeof(data)) != sizeof(data))
+            {
+                this->values[i] = 0;
+                continue;
+            }
+            // data: value, time enabled, time running
+            this->values[i] = data[2] == 0 ? 0 : static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+        }
+    }
+
+    void Perf_Counters::write_report(std::ostream &os, uint64_t bytes, uint64_t lines) const
+    {
+        if (!any_available())
+        {
+            os << "Perf counters unavailable: " << strerror(this->open_errno);
+            if (this->open_errno == EACCES || this->open_errno == EPERM)
+            {
+                os << " (check /proc/sys/kernel/perf_event_paranoid)";
+            }
+            os << std::endl;
+            return;
+        }
+
+        std::ios::fmtflags flags = os.flags();
+        os << std::left << std::setw(16) << "event" << std::right << std::setw(18) << "total"
+           << std::setw(14) << "per_byte" << std::setw(14) << "per_line" << std::endl;
+        os << std::fixed << std::setprecision(4);
+        for (int i = 0; i < PERF_EVENT_COUNT; ++i)
+        {
+            os << std::left << std::setw(16) << event_names[i] << std::right;
+            if (this->fds[i] < 0)
+            {
+                os << std::setw(18) << "n/a" << std::endl;
+                continue;
+            }
+            os << std::setw(18) << this->values[i]
+               << std::setw(14) << (bytes ? static_cast<double>(this->values[i]) / bytes : 0.0)
+               << std::setw(14) << (lines ? static_cast<double>(this->values[i]) / lines : 0.0) << std::endl;
+        }
+        if (available(PERF_CYCLES) && available(PERF_INSTRUCTIONS) && this->values[PERF_CYCLES] != 0)
+        {
+            os << "IPC: " << static_cast<double>(this->values[PERF_INSTRUCTIONS]) / this->values[PERF_CYCLES] << std::endl;
+        }
+        os.flags(flags);
+    }
+
+}
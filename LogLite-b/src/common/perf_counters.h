@@ -0,0 +1,51 @@
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <cstdint>
+#include <ostream>
+
+namespace XORC
+{
+
+    enum Perf_Event : int
+    {
+        PERF_CYCLES,
+        PERF_INSTRUCTIONS,
+        PERF_BRANCH_MISSES,
+        PERF_L1D_MISSES,
+        PERF_LLC_MISSES,
+        PERF_DTLB_MISSES,
+        PERF_EVENT_COUNT
+    };
+
+    // Linux perf_event_open counters for the calling thread (user space only). Each event is
+    // opened on its own so one the PMU lacks does not take the rest down; multiplexed counts
+    // are scaled by time enabled / time running.
+    class Perf_Counters
+    {
+    private:
+        int fds[PERF_EVENT_COUNT];
+        uint64_t values[PERF_EVENT_COUNT] = {};
+        int open_errno = 0;
+
+    public:
+        Perf_Counters();
+        ~Perf_Counters();
+
+        Perf_Counters(const Perf_Counters &) = delete;
+        Perf_Counters &operator=(const Perf_Counters &) = delete;
+
+        void start();
+        void stop();
+
+        bool available(Perf_Event event) const { return fds[event] >= 0; }
+        bool any_available() const;
+        uint64_t value(Perf_Event event) const { return values[event]; }
+
+        // Totals, IPC, and each event per input byte and per line.
+        void write_report(std::ostream &os, uint64_t bytes, uint64_t lines) const;
+    };
+
+}
+
+#endif
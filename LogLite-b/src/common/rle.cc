@@ -24,7 +24,7 @@ namespace XORC
         }
     }
 
-    static void encoder(boost::dynamic_bitset<> &output_data, uint64_t &len_output_data, size_t &length_encoded_bitset, bool isRLE, int &i, int i_len, const std::string &original_data)
+    static void encoder(Output_Bitset &output_data, uint64_t &len_output_data, size_t &length_encoded_bitset, bool isRLE, int &i, int i_len, std::string_view original_data)
     {
         if (isRLE)
         {
@@ -50,7 +50,33 @@ namespace XORC
         }
     }
 
-    size_t runLengthEncodeString(const std::string &input, boost::dynamic_bitset<> &output_data, uint64_t &len_output_data, const std::string &original_data)
+    size_t runLengthEncodedLength(const std::string &input)
+    {
+        const int len_input = input.size();
+
+        size_t length_encoded_bitset = 0;
+
+        int i = 0;
+        int i_len;
+        while (i < len_input)
+        {
+            i_len = 1;
+            if (input[i] == '\0' && isContinuous(input, i, i_len))
+            {
+                length_encoded_bitset += 1 + RLE_COUNT;
+                i += i_len;
+            }
+            else
+            {
+                length_encoded_bitset += 1 + RLE_SKIM;
+                ++i;
+            }
+        }
+
+        return length_encoded_bitset;
+    }
+
+    size_t runLengthEncodeString(const std::string &input, Output_Bitset &output_data, uint64_t &len_output_data, std::string_view original_data)
     {
 
         const int len_input = input.size();
@@ -3,16 +3,20 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <boost/dynamic_bitset.hpp>
 #include <vector>
 #include <immintrin.h>
 
 #include "common/constants.h"
+#include "common/huge_pages.h"
 
 namespace XORC
 {
 
-    size_t runLengthEncodeString(const std::string &input, boost::dynamic_bitset<> &output_data, uint64_t &len_output_data, const std::string &single_data);
+    // Number of bits runLengthEncodeString would write for input.
+    size_t runLengthEncodedLength(const std::string &input);
+    size_t runLengthEncodeString(const std::string &input, Output_Bitset &output_data, uint64_t &len_output_data, std::string_view single_data);
 
 }
 
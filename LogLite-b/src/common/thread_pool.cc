@@ -0,0 +1,132 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace XORC
+{
+
+    // which pool, if any, the current thread works for
+    static thread_local const Thread_Pool *current_pool = nullptr;
+    static thread_local size_t current_index = 0;
+
+    Thread_Pool::Thread_Pool(unsigned thread_count)
+    {
+        thread_count = std::max(1u, thread_count);
+        for (unsigned i = 0; i < thread_count; ++i)
+        {
+            this->queues.emplace_back(new Worker_Queue());
+        }
+        for (unsigned i = 0; i < thread_count; ++i)
+        {
+            this->workers.emplace_back(&Thread_Pool::worker_loop, this, i);
+        }
+    }
+
+    Thread_Pool::~Thread_Pool()
+    {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->work_cv.notify_all();
+        for (std::thread &worker : this->workers)
+        {
+            worker.join();
+        }
+    }
+
+    void Thread_Pool::submit(std::function<void()> task)
+    {
+        size_t index;
+        if (current_pool == this)
+        {
+            index = current_index;
+        }
+        else
+        {
+            index = this->next_queue.fetch_add(1, std::memory_order_relaxed) % this->queues.size();
+        }
+
+        {
+            // counted under the pool mutex so a worker about to sleep cannot miss it
+            std::lock_guard<std::mutex> lock(this->mutex);
+            ++this->pending;
+            this->queued.fetch_add(1);
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->queues[index]->mutex);
+            this->queues[index]->tasks.push_back(std::move(task));
+        }
+        this->work_cv.notify_one();
+    }
+
+    void Thread_Pool::wait()
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->done_cv.wait(lock, [this]
+                           { return this->pending == 0; });
+    }
+
+    bool Thread_Pool::pop(size_t index, std::function<void()> &task)
+    {
+        Worker_Queue &queue = *this->queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool Thread_Pool::steal(size_t index, std::function<void()> &task)
+    {
+        for (size_t k = 1; k < this->queues.size(); ++k)
+        {
+            Worker_Queue &queue = *this->queues[(index + k) % this->queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Thread_Pool::worker_loop(size_t index)
+    {
+        current_pool = this;
+        current_index = index;
+
+        while (true)
+        {
+            std::function<void()> task;
+            if (pop(index, task) || steal(index, task))
+            {
+                this->queued.fetch_sub(1);
+                task();
+                task = nullptr;
+
+                std::lock_guard<std::mutex> lock(this->mutex);
+                if (--this->pending == 0)
+                {
+                    this->done_cv.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->work_cv.wait(lock, [this]
+                               { return this->stopping || this->queued.load() > 0; });
+            if (this->stopping)
+            {
+                return;
+            }
+        }
+    }
+
+}
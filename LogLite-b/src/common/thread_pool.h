@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+namespace XORC
+{
+
+    // Fixed set of workers, each with its own task deque. A worker runs its newest task first and,
+    // when its deque is empty, steals the oldest task from another worker. Tasks submitted from a
+    // worker go to that worker's deque; others are spread round-robin.
+    class Thread_Pool
+    {
+    private:
+        struct Worker_Queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker_Queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable work_cv;
+        std::condition_variable done_cv;
+        std::atomic<size_t> queued{0};
+        size_t pending = 0;
+        bool stopping = false;
+        std::atomic<size_t> next_queue{0};
+
+        void worker_loop(size_t index);
+        bool pop(size_t index, std::function<void()> &task);
+        bool steal(size_t index, std::function<void()> &task);
+
+    public:
+        explicit Thread_Pool(unsigned thread_count);
+        ~Thread_Pool();
+
+        Thread_Pool(const Thread_Pool &) = delete;
+        Thread_Pool &operator=(const Thread_Pool &) = delete;
+
+        void submit(std::function<void()> task);
+        // Blocks until every submitted task, including ones submitted by tasks, has finished.
+        void wait();
+
+        size_t size() const { return workers.size(); }
+    };
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+#include "timestamp.h"
+
+#include <stdexcept>
+
+namespace XORC
+{
+
+    static bool readDigits(std::string_view text, size_t &pos, int count, int &value)
+    {
+        if (text.size() - pos < static_cast<size_t>(count))
+        {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            char c = text[pos++];
+            if (c < '0' || c > '9')
+            {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+        }
+        return true;
+    }
+
+    // Days since 1970-01-01 of a proleptic Gregorian date.
+    static int64_t daysFromCivil(int64_t year, int month, int day)
+    {
+        year -= month <= 2;
+        int64_t era = (year >= 0 ? year : year - 399) / 400;
+        int64_t year_of_era = year - era * 400;
+        int64_t day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        int64_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+        return era * 146097 + day_of_era - 719468;
+    }
+
+    Timestamp_Format::Timestamp_Format(std::string format) : format(std::move(format))
+    {
+        for (size_t i = 0; i < this->format.size(); ++i)
+        {
+            if (this->format[i] != '%')
+            {
+                continue;
+            }
+            if (++i == this->format.size() || std::string_view("YmdHMSf%").find(this->format[i]) == std::string_view::npos)
+            {
+                throw std::runtime_error("Unsupported timestamp format: " + this->format);
+            }
+        }
+    }
+
+    bool Timestamp_Format::parse(std::string_view text, int64_t &seconds) const
+    {
+        int year = 1970, month = 1, day = 1, hour = 0, minute = 0, second = 0;
+        size_t pos = 0;
+        for (size_t i = 0; i < this->format.size(); ++i)
+        {
+            if (this->format[i] != '%' || this->format[i + 1] == '%')
+            {
+                i += this->format[i] == '%';
+                if (pos >= text.size() || text[pos++] != this->format[i])
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            bool matched = true;
+            switch (this->format[++i])
+            {
+            case 'Y':
+                matched = readDigits(text, pos, 4, year);
+                break;
+            case 'm':
+                matched = readDigits(text, pos, 2, month) && month >= 1 && month <= 12;
+                break;
+            case 'd':
+                matched = readDigits(text, pos, 2, day) && day >= 1 && day <= 31;
+                break;
+            case 'H':
+                matched = readDigits(text, pos, 2, hour) && hour <= 23;
+                break;
+            case 'M':
+                matched = readDigits(text, pos, 2, minute) && minute <= 59;
+                break;
+            case 'S':
+                matched = readDigits(text, pos, 2, second) && second <= 60;
+                break;
+            case 'f':
+            {
+                size_t begin = pos;
+                while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+                {
+                    ++pos;
+                }
+                matched = pos > begin;
+                break;
+            }
+            }
+            if (!matched)
+            {
+                return false;
+            }
+        }
+
+        seconds = ((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60 + second;
+        return true;
+    }
+
+}
@@ -0,0 +1,30 @@
+#ifndef TIMESTAMP_H_
+#define TIMESTAMP_H_
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace XORC
+{
+
+    // A strptime-like pattern matched against the start of a line. %Y is four digits, %m %d %H %M %S
+    // two digits each, %f one or more fraction digits (ignored) and %% a literal '%'; any other
+    // character must match itself. Times are seconds since the epoch, read as UTC.
+    class Timestamp_Format
+    {
+    private:
+        std::string format;
+
+    public:
+        explicit Timestamp_Format(std::string format);
+
+        const std::string &str() const { return format; }
+
+        // Returns false when the text does not start with a timestamp in this format.
+        bool parse(std::string_view text, int64_t &seconds) const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace XORC
+{
+    bool trace_enabled = false;
+
+    static const char *stage_names[TRACE_STAGE_COUNT] = {
+        "read", "split", "candidate_search", "rle_encode", "bit_packing", "window_update",
+        "serialize", "write", "parse", "rle_decode", "reconstruct"};
+
+    struct Stage_Totals
+    {
+        std::atomic<uint64_t> wall_ns{0};
+        std::atomic<uint64_t> cpu_ns{0};
+        std::atomic<uint64_t> cycles{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> calls{0};
+    };
+
+    struct Trace_Event
+    {
+        Trace_Stage stage;
+        uint64_t begin_ns;
+        uint64_t wall_ns;
+        uint64_t bytes;
+        long tid;
+    };
+
+    static Stage_Totals stage_totals[TRACE_STAGE_COUNT];
+
+    static bool chrome_enabled = false;
+    static std::mutex events_mutex;
+    static std::vector<Trace_Event> events;
+
+    static uint64_t calibration_ns = 0;
+    static uint64_t calibration_cycles = 0;
+
+    uint64_t traceWallNanos()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t traceThreadCpuNanos()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    void enableTracing(bool chrome_events)
+    {
+        trace_enabled = true;
+        chrome_enabled = chrome_events;
+        calibration_ns = traceWallNanos();
+        calibration_cycles = __rdtsc();
+    }
+
+    void traceAdd(Trace_Stage stage, uint64_t wall_ns, uint64_t cpu_ns, uint64_t bytes)
+    {
+        Stage_Totals &totals = stage_totals[stage];
+        totals.wall_ns.fetch_add(wall_ns, std::memory_order_relaxed);
+        totals.cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+        totals.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        totals.calls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void traceAddCycles(Trace_Stage stage, uint64_t cycles, uint64_t bytes)
+    {
+        Stage_Totals &totals = stage_totals[stage];
+        totals.cycles.fetch_add(cycles, std::memory_order_relaxed);
+        totals.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        totals.calls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void traceEvent(Trace_Stage stage, uint64_t begin_ns, uint64_t wall_ns, uint64_t bytes)
+    {
+        if (!chrome_enabled)
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(events_mutex);
+        events.push_back({stage, begin_ns, wall_ns, bytes, static_cast<long>(syscall(SYS_gettid))});
+    }
+
+    static double nanosPerCycle()
+    {
+        uint64_t ns = traceWallNanos() - calibration_ns;
+        uint64_t cycles = __rdtsc() - calibration_cycles;
+        return cycles == 0 ? 0.0 : static_cast<double>(ns) / cycles;
+    }
+
+    void writeTraceReport(std::ostream &os)
+    {
+        const double ns_per_cycle = nanosPerCycle();
+
+        os << std::left << std::setw(18) << "stage" << std::right
+           << std::setw(12) << "wall_ms" << std::setw(12) << "cpu_ms"
+           << std::setw(16) << "bytes" << std::setw(12) << "MB/s" << std::setw(12) << "calls" << std::endl;
+
+        std::ios::fmtflags flags = os.flags();
+        os << std::fixed << std::setprecision(2);
+        for (int stage = 0; stage < TRACE_STAGE_COUNT; ++stage)
+        {
+            const Stage_Totals &totals = stage_totals[stage];
+            uint64_t calls = totals.calls.load();
+            if (calls == 0)
+            {
+                continue;
+            }
+
+            bool cycle_timed = totals.cycles.load() != 0;
+            double wall_ms = cycle_timed ? totals.cycles.load() * ns_per_cycle / 1e6 : totals.wall_ns.load() / 1e6;
+            uint64_t bytes = totals.bytes.load();
+
+            os << std::left << std::setw(18) << stage_names[stage] << std::right << std::setw(12) << wall_ms;
+            if (cycle_timed)
+            {
+                os << std::setw(12) << "-";
+            }
+            else
+            {
+                os << std::setw(12) << totals.cpu_ns.load() / 1e6;
+            }
+            os << std::setw(16) << bytes;
+            if (bytes != 0 && wall_ms > 0)
+            {
+                os << std::setw(12) << bytes / (1024.0 * 1024.0) / (wall_ms / 1e3);
+            }
+            else
+            {
+                os << std::setw(12) << "-";
+            }
+            os << std::setw(12) << calls << std::endl;
+        }
+        os.flags(flags);
+    }
+
+    void writeChromeTrace(const char *filename)
+    {
+        std::ofstream file(filename);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open trace file for writing.");
+        }
+
+        const long pid = getpid();
+        std::lock_guard<std::mutex> lock(events_mutex);
+        file << "{\"traceEvents\": [";
+        for (size_t i = 0; i < events.size(); ++i)
+        {
+            const Trace_Event &event = events[i];
+            file << (i ? ",\n" : "\n")
+                 << "{\"name\": \"" << stage_names[event.stage] << "\", \"ph\": \"X\", \"pid\": " << pid
+                 << ", \"tid\": " << event.tid
+                 << ", \"ts\": " << (event.begin_ns - calibration_ns) / 1000.0
+                 << ", \"dur\": " << event.wall_ns / 1000.0
+                 << ", \"args\": {\"bytes\": " << event.bytes << "}}";
+        }
+        file << "\n], \"displayTimeUnit\": \"ms\"}\n";
+    }
+
+}
@@ -0,0 +1,117 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdint>
+#include <ostream>
+#include <x86intrin.h>
+
+namespace XORC
+{
+
+    enum Trace_Stage : int
+    {
+        TRACE_READ,
+        TRACE_SPLIT,
+        TRACE_CANDIDATE_SEARCH,
+        TRACE_RLE_ENCODE,
+        TRACE_BIT_PACKING,
+        TRACE_WINDOW_UPDATE,
+        TRACE_SERIALIZE,
+        TRACE_WRITE,
+        TRACE_PARSE,
+        TRACE_RLE_DECODE,
+        TRACE_RECONSTRUCT,
+        TRACE_STAGE_COUNT
+    };
+
+    extern bool trace_enabled;
+
+    // chrome_events also keeps one event per coarse timer for writeChromeTrace.
+    void enableTracing(bool chrome_events);
+    void traceAdd(Trace_Stage stage, uint64_t wall_ns, uint64_t cpu_ns, uint64_t bytes);
+    void traceAddCycles(Trace_Stage stage, uint64_t cycles, uint64_t bytes);
+    void traceEvent(Trace_Stage stage, uint64_t begin_ns, uint64_t wall_ns, uint64_t bytes);
+
+    uint64_t traceWallNanos();
+    uint64_t traceThreadCpuNanos();
+
+    // Per-stage wall time, CPU time (coarse stages only) and bytes, as a table.
+    void writeTraceReport(std::ostream &os);
+    // Chrome trace-event JSON (chrome://tracing, Perfetto); coarse timers only.
+    void writeChromeTrace(const char *filename);
+
+    // Wall and thread-CPU time for stages entered a few times per run.
+    class Scoped_Timer
+    {
+    private:
+        Trace_Stage stage;
+        uint64_t bytes;
+        uint64_t wall_begin = 0;
+        uint64_t cpu_begin = 0;
+        bool active;
+
+    public:
+        explicit Scoped_Timer(Trace_Stage stage, uint64_t bytes = 0) : stage(stage), bytes(bytes), active(trace_enabled)
+        {
+            if (active)
+            {
+                wall_begin = traceWallNanos();
+                cpu_begin = traceThreadCpuNanos();
+            }
+        }
+
+        ~Scoped_Timer()
+        {
+            stop();
+        }
+
+        void stop()
+        {
+            if (active)
+            {
+                uint64_t wall_ns = traceWallNanos() - wall_begin;
+                traceAdd(stage, wall_ns, traceThreadCpuNanos() - cpu_begin, bytes);
+                traceEvent(stage, wall_begin, wall_ns, bytes);
+                active = false;
+            }
+        }
+
+        void add_bytes(uint64_t count) { bytes += count; }
+    };
+
+    // TSC-based timer for per-line stages inside the codec; converted to time at report.
+    class Cycle_Timer
+    {
+    private:
+        Trace_Stage stage;
+        uint64_t bytes;
+        uint64_t begin = 0;
+        bool active;
+
+    public:
+        Cycle_Timer(Trace_Stage stage, uint64_t bytes) : stage(stage), bytes(bytes), active(trace_enabled)
+        {
+            if (active)
+            {
+                begin = __rdtsc();
+            }
+        }
+
+        ~Cycle_Timer()
+        {
+            stop();
+        }
+
+        void stop()
+        {
+            if (active)
+            {
+                traceAddCycles(stage, __rdtsc() - begin, bytes);
+                active = false;
+            }
+        }
+    };
+
+}
+
+#endif
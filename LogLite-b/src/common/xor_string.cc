@@ -3,7 +3,7 @@
 namespace XORC
 {
 
-    std::string bitwiseXor(const std::string &a, const std::string &b)
+    std::string bitwiseXor(std::string_view a, std::string_view b)
     {
 
         std::string result;
@@ -36,7 +36,7 @@ namespace XORC
         return result;
     }
 
-    void bitwiseXor(const std::string &a, const std::string &b, std::string &result)
+    void bitwiseXor(std::string_view a, std::string_view b, std::string &result)
     {
 
         size_t i = 0;
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <immintrin.h>
 #include <stdexcept>
 #include <chrono>
@@ -12,8 +13,8 @@
 namespace XORC
 {
 
-    std::string bitwiseXor(const std::string &a, const std::string &b);
-    void bitwiseXor(const std::string &a, const std::string &b, std::string &result);
+    std::string bitwiseXor(std::string_view a, std::string_view b);
+    void bitwiseXor(std::string_view a, std::string_view b, std::string &result);
 }
 
 #endif
\ No newline at end of file
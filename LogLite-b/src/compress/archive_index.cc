@@ -0,0 +1,137 @@
+#include "archive_index.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+#include "common/bit_coding.h"
+#include "common/constants.h"
+#include "common/file.h"
+
+namespace XORC
+{
+
+    static std::string readBytes(const std::string &content, size_t &pos)
+    {
+        uint64_t len_bytes = readVarint(content, pos);
+        if (content.size() - pos < len_bytes)
+        {
+            throw std::runtime_error("Malformed archive index.");
+        }
+        pos += len_bytes;
+        return content.substr(pos - len_bytes, len_bytes);
+    }
+
+    static void writeBytes(std::string &entry, const std::string &bytes)
+    {
+        writeVarint(entry, bytes.size());
+        entry += bytes;
+    }
+
+    static void readHeader(const std::string &content, size_t &pos, Archive_Index_Header &header, uint64_t &version)
+    {
+        if (content.empty() || readVarint(content, pos) != ARCHIVE_INDEX_MAGIC)
+        {
+            throw std::runtime_error("Unrecognized archive index.");
+        }
+        version = readVarint(content, pos);
+        if (version > ARCHIVE_INDEX_VERSION)
+        {
+            throw std::runtime_error("Unsupported archive index version.");
+        }
+        uint64_t flags = readVarint(content, pos);
+        header.timestamp_format = readBytes(content, pos);
+        header.trigram_filters = flags & ARCHIVE_INDEX_TRIGRAMS;
+        if (((flags & ARCHIVE_INDEX_TIME) != 0) != header.has_time())
+        {
+            throw std::runtime_error("Malformed archive index.");
+        }
+    }
+
+    Archive_Index_Writer::Archive_Index_Writer(const std::string &path, const Archive_Index_Header &header, bool append)
+        : header(header)
+    {
+        std::error_code error;
+        bool is_continued = append && std::filesystem::is_regular_file(path, error);
+        if (is_continued)
+        {
+            std::string content;
+            read_string_from_file(content, path.c_str());
+            size_t pos = 0;
+            uint64_t version;
+            Archive_Index_Header existing;
+            readHeader(content, pos, existing, version);
+            if (version != ARCHIVE_INDEX_VERSION || !(existing == header))
+            {
+                throw std::runtime_error("Appending needs the archive index options the archive was started with.");
+            }
+        }
+        this->file.open(path, std::ios::binary | (is_continued ? std::ios::app : std::ios::trunc));
+        if (!this->file)
+        {
+            throw std::runtime_error("Cannot open archive index " + path);
+        }
+        if (is_continued)
+        {
+            return;
+        }
+
+        writeVarint(this->entry, ARCHIVE_INDEX_MAGIC);
+        writeVarint(this->entry, ARCHIVE_INDEX_VERSION);
+        writeVarint(this->entry, (header.has_time() ? ARCHIVE_INDEX_TIME : 0) | (header.trigram_filters ? ARCHIVE_INDEX_TRIGRAMS : 0));
+        writeBytes(this->entry, header.timestamp_format);
+        this->file.write(this->entry.data(), this->entry.size());
+    }
+
+    void Archive_Index_Writer::add(const Archive_Checkpoint &checkpoint)
+    {
+        this->entry.clear();
+        writeVarint(this->entry, checkpoint.bit_offset);
+        if (this->header.has_time())
+        {
+            writeVarint(this->entry, zigzagEncode(checkpoint.initial_time));
+            writeVarint(this->entry, zigzagEncode(checkpoint.min_time));
+            writeVarint(this->entry, zigzagEncode(checkpoint.max_time));
+        }
+        if (this->header.trigram_filters)
+        {
+            writeBytes(this->entry, checkpoint.trigram_filter);
+        }
+        writeBytes(this->entry, checkpoint.window);
+        this->file.write(this->entry.data(), this->entry.size());
+        this->file.flush();
+    }
+
+    void read_archive_index(const std::string &path, Archive_Index_Header &header, std::vector<Archive_Checkpoint> &checkpoints)
+    {
+        std::string content;
+        read_string_from_file(content, path.c_str());
+
+        size_t pos = 0;
+        uint64_t version;
+        readHeader(content, pos, header, version);
+
+        checkpoints.clear();
+        while (pos < content.size())
+        {
+            Archive_Checkpoint checkpoint;
+            checkpoint.bit_offset = readVarint(content, pos);
+            if (header.has_time())
+            {
+                checkpoint.initial_time = zigzagDecode(readVarint(content, pos));
+                checkpoint.min_time = zigzagDecode(readVarint(content, pos));
+                checkpoint.max_time = zigzagDecode(readVarint(content, pos));
+            }
+            if (header.trigram_filters)
+            {
+                checkpoint.trigram_filter = readBytes(content, pos);
+            }
+            checkpoint.window = readBytes(content, pos);
+            if (!checkpoints.empty() && checkpoint.bit_offset < checkpoints.back().bit_offset)
+            {
+                throw std::runtime_error("Malformed archive index.");
+            }
+            checkpoints.push_back(std::move(checkpoint));
+        }
+    }
+
+}
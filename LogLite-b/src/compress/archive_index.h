@@ -0,0 +1,63 @@
+#ifndef XORC_STREAM_COMPRESS_ARCHIVE_INDEX_H_
+#define XORC_STREAM_COMPRESS_ARCHIVE_INDEX_H_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <limits>
+
+namespace XORC
+{
+
+    // One interval of an archive: decoding can start at bit_offset after loading window. A line
+    // without a timestamp takes the one of the line before it; initial_time is the one in effect
+    // when the interval starts, min_time/max_time span all lines of the interval (empty: min > max).
+    // trigram_filter is a Bloom filter over the interval's lines (common/bloom_filter.h).
+    struct Archive_Checkpoint
+    {
+        uint64_t bit_offset = 0;
+        int64_t initial_time = std::numeric_limits<int64_t>::min();
+        int64_t min_time = std::numeric_limits<int64_t>::max();
+        int64_t max_time = std::numeric_limits<int64_t>::min();
+        std::string trigram_filter;
+        std::string window;
+
+        bool overlaps(int64_t since, int64_t until) const { return min_time <= until && max_time >= since; }
+    };
+
+    // What an index records besides offsets and windows; an empty timestamp format means no time spans.
+    struct Archive_Index_Header
+    {
+        std::string timestamp_format;
+        bool trigram_filters = false;
+
+        bool has_time() const { return !timestamp_format.empty(); }
+        bool operator==(const Archive_Index_Header &other) const
+        {
+            return timestamp_format == other.timestamp_format && trigram_filters == other.trigram_filters;
+        }
+    };
+
+    // Sidecar file next to an archive: magic, version, flags, timestamp format, then the checkpoints
+    // in archive order, all varint coded. Checkpoints are appended as their intervals close.
+    class Archive_Index_Writer
+    {
+    private:
+        std::ofstream file;
+        std::string entry;
+        Archive_Index_Header header;
+
+    public:
+        // With append, adds to an existing index, which must have been started with the same
+        // header (a missing one is started fresh).
+        Archive_Index_Writer(const std::string &path, const Archive_Index_Header &header, bool append);
+
+        void add(const Archive_Checkpoint &checkpoint);
+    };
+
+    void read_archive_index(const std::string &path, Archive_Index_Header &header, std::vector<Archive_Checkpoint> &checkpoints);
+
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include "compress_stats.h"
+
+namespace XORC
+{
+
+    void Length_Bucket_Stats::add(const Length_Bucket_Stats &other)
+    {
+        lines += other.lines;
+        bytes += other.bytes;
+        raw_first_seen += other.raw_first_seen;
+        raw_oversize += other.raw_oversize;
+        raw_empty += other.raw_empty;
+        raw_cheaper += other.raw_cheaper;
+        xor_records += other.xor_records;
+        bitmask_records += other.bitmask_records;
+        segment_switches += other.segment_switches;
+        chunked_lines += other.chunked_lines;
+        candidates_scanned += other.candidates_scanned;
+        early_exits += other.early_exits;
+        for (int i = 0; i < EACH_WINDOW_SIZE; ++i)
+        {
+            window_index[i] += other.window_index[i];
+        }
+        literal_tokens += other.literal_tokens;
+        run_tokens += other.run_tokens;
+        header_bits += other.header_bits;
+        payload_bits += other.payload_bits;
+        numeric_delta_bits += other.numeric_delta_bits;
+    }
+
+    static void writeBucketJson(std::ostream &os, const Length_Bucket_Stats &stats, const char *indent)
+    {
+        os << "{\n";
+        os << indent << "  \"lines\": " << stats.lines << ",\n";
+        os << indent << "  \"bytes\": " << stats.bytes << ",\n";
+        os << indent << "  \"raw_first_seen\": " << stats.raw_first_seen << ",\n";
+        os << indent << "  \"raw_oversize\": " << stats.raw_oversize << ",\n";
+        os << indent << "  \"raw_empty\": " << stats.raw_empty << ",\n";
+        os << indent << "  \"raw_cheaper\": " << stats.raw_cheaper << ",\n";
+        os << indent << "  \"xor_records\": " << stats.xor_records << ",\n";
+        os << indent << "  \"bitmask_records\": " << stats.bitmask_records << ",\n";
+        os << indent << "  \"segment_switches\": " << stats.segment_switches << ",\n";
+        os << indent << "  \"chunked_lines\": " << stats.chunked_lines << ",\n";
+        os << indent << "  \"candidates_scanned\": " << stats.candidates_scanned << ",\n";
+        os << indent << "  \"early_exits\": " << stats.early_exits << ",\n";
+        os << indent << "  \"window_index\": [";
+        for (int i = 0; i < EACH_WINDOW_SIZE; ++i)
+        {
+            os << (i ? ", " : "") << stats.window_index[i];
+        }
+        os << "],\n";
+        os << indent << "  \"literal_tokens\": " << stats.literal_tokens << ",\n";
+        os << indent << "  \"run_tokens\": " << stats.run_tokens << ",\n";
+        os << indent << "  \"header_bits\": " << stats.header_bits << ",\n";
+        os << indent << "  \"payload_bits\": " << stats.payload_bits << ",\n";
+        os << indent << "  \"numeric_delta_bits\": " << stats.numeric_delta_bits << "\n";
+        os << indent << "}";
+    }
+
+    void Compress_Stats::write_json(std::ostream &os) const
+    {
+        Length_Bucket_Stats total;
+        for (const auto &bucket : buckets)
+        {
+            total.add(bucket);
+        }
+
+        os << "{\n  \"total\": ";
+        writeBucketJson(os, total, "  ");
+        os << ",\n  \"window\": {\"resident_bytes\": " << window_bytes
+           << ", \"peak_bytes\": " << window_peak_bytes
+           << ", \"buckets\": " << window_buckets
+           << ", \"evicted_buckets\": " << evicted_buckets
+           << ", \"evicted_bytes\": " << evicted_bytes << "}";
+        os << ",\n  \"length_buckets\": [";
+
+        bool first = true;
+        for (size_t i = 0; i < STATS_LENGTH_BUCKET_COUNT; ++i)
+        {
+            if (buckets[i].lines == 0)
+            {
+                continue;
+            }
+            size_t min_len = i == 0 ? 0 : static_cast<size_t>(1) << (i - 1);
+            os << (first ? "\n" : ",\n") << "    {\"min_length\": " << min_len << ", ";
+            if (i + 1 < STATS_LENGTH_BUCKET_COUNT)
+            {
+                os << "\"max_length\": " << (i == 0 ? 0 : (static_cast<size_t>(1) << i) - 1) << ", ";
+            }
+            os << "\"stats\": ";
+            writeBucketJson(os, buckets[i], "    ");
+            os << "}";
+            first = false;
+        }
+        os << (first ? "]\n}\n" : "\n  ]\n}\n");
+    }
+
+}
@@ -0,0 +1,73 @@
+#ifndef XORC_STREAM_COMPRESS_STATS_H_
+#define XORC_STREAM_COMPRESS_STATS_H_
+
+#include <ostream>
+#include <cstdint>
+
+#include "common/constants.h"
+
+// Counters are only compiled in with -DXORC_STATS; otherwise XORC_STAT() expands to nothing.
+#ifdef XORC_STATS
+#define XORC_STAT(statement) statement
+#else
+#define XORC_STAT(statement)
+#endif
+
+namespace XORC
+{
+
+    struct Length_Bucket_Stats
+    {
+        uint64_t lines = 0;
+        uint64_t bytes = 0;
+
+        uint64_t raw_first_seen = 0;
+        uint64_t raw_oversize = 0;
+        uint64_t raw_empty = 0;
+        uint64_t raw_cheaper = 0;
+        uint64_t xor_records = 0;
+        uint64_t bitmask_records = 0;
+        uint64_t segment_switches = 0;
+        uint64_t chunked_lines = 0;
+
+        uint64_t candidates_scanned = 0;
+        uint64_t early_exits = 0;
+        uint64_t window_index[EACH_WINDOW_SIZE] = {};
+
+        uint64_t literal_tokens = 0;
+        uint64_t run_tokens = 0;
+
+        uint64_t header_bits = 0;
+        uint64_t payload_bits = 0;
+        uint64_t numeric_delta_bits = 0;
+
+        void add(const Length_Bucket_Stats &other);
+    };
+
+    // Lines are bucketed by bit width of their length: 0, 1, 2-3, 4-7, ..., and everything >= 2^14.
+    struct Compress_Stats
+    {
+        Length_Bucket_Stats buckets[STATS_LENGTH_BUCKET_COUNT];
+
+        // resident history: bytes charged to the window (line content plus the fixed bucket and
+        // line overhead, see WINDOW_BUCKET_OVERHEAD), current and peak
+        uint64_t window_bytes = 0;
+        uint64_t window_peak_bytes = 0;
+        uint64_t window_buckets = 0;
+        uint64_t evicted_buckets = 0;
+        uint64_t evicted_bytes = 0;
+
+        static size_t bucket_of(size_t len_single_data)
+        {
+            size_t bucket = len_single_data == 0 ? 0 : 64 - __builtin_clzll(len_single_data);
+            return bucket < STATS_LENGTH_BUCKET_COUNT ? bucket : STATS_LENGTH_BUCKET_COUNT - 1;
+        }
+
+        Length_Bucket_Stats &bucket(size_t len_single_data) { return buckets[bucket_of(len_single_data)]; }
+
+        void write_json(std::ostream &os) const;
+    };
+
+}
+
+#endif
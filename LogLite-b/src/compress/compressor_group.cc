@@ -0,0 +1,193 @@
+#include "compressor_group.h"
+
+#include <stdexcept>
+
+#include "common/line_index.h"
+
+namespace XORC
+{
+
+    Compressor_Group::Compressor_Group(unsigned thread_count, const Stream_Options &options)
+        : options(options), pool(thread_count)
+    {
+    }
+
+    Compressor_Group::~Compressor_Group()
+    {
+        this->pool.wait();
+    }
+
+    size_t Compressor_Group::add_source(const std::string &output_path, bool checksums, bool direct_io)
+    {
+        std::unique_ptr<Source> source(new Source(this->options));
+        // written from the pool worker compressing the source, so no writer thread per source
+        source->sink.reset(new Output_Sink(output_path.c_str(), direct_io, false, GROUP_OUTPUT_CHUNK_SIZE, true));
+        if (checksums)
+        {
+            source->sink->enable_checksums();
+        }
+
+        source->output_data.resize(2 * GROUP_OUTPUT_CHUNK_SIZE * 8);
+        source->compressor.write_stream_header(source->output_data, source->len_output_data);
+
+        this->sources.push_back(std::move(source));
+        return this->sources.size() - 1;
+    }
+
+    void Compressor_Group::submit(size_t source_id, std::string_view text)
+    {
+        Batch batch;
+        batch.text = text;
+        enqueue(*this->sources[source_id], std::move(batch));
+    }
+
+    void Compressor_Group::submit(size_t source_id, std::string &&text)
+    {
+        Batch batch;
+        batch.owned = std::move(text);
+        enqueue(*this->sources[source_id], std::move(batch));
+    }
+
+    void Compressor_Group::enqueue(Source &source, Batch &&batch)
+    {
+        std::lock_guard<std::mutex> lock(source.mutex);
+        source.batches.push_back(std::move(batch));
+        if (!source.scheduled)
+        {
+            source.scheduled = true;
+            this->pool.submit([this, &source]
+                              { run(source); });
+        }
+    }
+
+    // Compresses one batch, then requeues the source if more arrived, so a busy source
+    // cannot hold a worker while others wait.
+    void Compressor_Group::run(Source &source)
+    {
+        Batch batch;
+        {
+            std::lock_guard<std::mutex> lock(source.mutex);
+            batch = std::move(source.batches.front());
+            source.batches.pop_front();
+        }
+
+        try
+        {
+            compress_text(source, batch.view());
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(this->error_mutex);
+            if (!this->error)
+            {
+                this->error = std::current_exception();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(source.mutex);
+        if (source.batches.empty())
+        {
+            source.scheduled = false;
+        }
+        else
+        {
+            this->pool.submit([this, &source]
+                              { run(source); });
+        }
+    }
+
+    void Compressor_Group::compress_text(Source &source, std::string_view text)
+    {
+        source.newlines.clear();
+        findNewlines(text.data(), 0, text.size(), source.newlines);
+        if (!text.empty() && text.back() != '\n')
+        {
+            source.newlines.push_back(text.size());
+        }
+
+        // block mode: the lines of a block are compressed together, and a batch ends its last block
+        const size_t reorder_block = this->options.reorder_block;
+        source.block.clear();
+        auto compress_block = [&]()
+        {
+            source.compressor.stream_compress_block(source.block.data(), source.block.size(), source.output_data, source.len_output_data);
+            source.line_count += source.block.size();
+            source.block.clear();
+            if (source.len_output_data >= GROUP_OUTPUT_CHUNK_SIZE * 8)
+            {
+                drain(source);
+            }
+        };
+
+        size_t start = 0;
+        for (uint64_t newline : source.newlines)
+        {
+            size_t end = newline;
+            if (end > start && text[end - 1] == '\r')
+            {
+                --end;
+            }
+            std::string_view line = text.substr(start, end - start);
+            start = newline + 1;
+
+            if (reorder_block > 0)
+            {
+                source.block.push_back(line);
+                if (source.block.size() == reorder_block)
+                {
+                    compress_block();
+                }
+                continue;
+            }
+
+            size_t max_record_bits = Stream_Compress::max_record_bits(line.size());
+            if (source.len_output_data + max_record_bits > source.output_data.size())
+            {
+                source.output_data.resize(source.len_output_data + max_record_bits);
+            }
+            source.compressor.stream_compress(line, source.output_data, source.len_output_data);
+            ++source.line_count;
+
+            if (source.len_output_data >= GROUP_OUTPUT_CHUNK_SIZE * 8)
+            {
+                drain(source);
+            }
+        }
+        if (!source.block.empty())
+        {
+            compress_block();
+        }
+        source.raw_bytes += text.size();
+    }
+
+    void Compressor_Group::drain(Source &source)
+    {
+        const uint64_t len_output_data = source.len_output_data;
+        source.sink->drain(source.output_data, source.len_output_data);
+        source.total_bits += len_output_data - source.len_output_data;
+    }
+
+    void Compressor_Group::finish()
+    {
+        this->pool.wait();
+        if (this->error)
+        {
+            std::rethrow_exception(this->error);
+        }
+
+        const size_t bits_per_block = Output_Bitset::bits_per_block;
+        for (std::unique_ptr<Source> &source : this->sources)
+        {
+            if (source->sink)
+            {
+                source->total_bits += source->len_output_data;
+                source->sink->finish(source->output_data, source->len_output_data, source->total_bits);
+                source->sink.reset();
+                // the blocks plus the last_block_bits word
+                source->compressed_bytes = ((source->total_bits + bits_per_block - 1) / bits_per_block + 1) * sizeof(unsigned long);
+                source->len_output_data = 0;
+            }
+        }
+    }
+
+}
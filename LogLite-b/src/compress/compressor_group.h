@@ -0,0 +1,101 @@
+#ifndef XORC_STREAM_COMPRESS_COMPRESSOR_GROUP_H_
+#define XORC_STREAM_COMPRESS_COMPRESSOR_GROUP_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <exception>
+#include <boost/dynamic_bitset.hpp>
+
+#include "common/constants.h"
+#include "common/thread_pool.h"
+#include "common/output_sink.h"
+#include "compress/stream_compress.h"
+
+namespace XORC
+{
+
+    // Compresses many independent log streams at once. Every source keeps its own Stream_Compress
+    // window and writes its own archive (the layout of xorc-cli --compress). Batches of one source
+    // are compressed in submission order, one at a time; different sources share a Thread_Pool.
+    // With a reorder_block, reordering blocks do not span batches.
+    // add_source() and submit() are meant to be called from a single thread.
+    class Compressor_Group
+    {
+    private:
+        struct Batch
+        {
+            std::string owned;
+            std::string_view text;
+
+            std::string_view view() const { return owned.empty() ? text : std::string_view(owned); }
+        };
+
+        struct Source
+        {
+            std::mutex mutex;
+            std::deque<Batch> batches;
+            bool scheduled = false;
+
+            Stream_Compress compressor;
+            std::unique_ptr<Output_Sink> sink;
+            Output_Bitset output_data;
+            uint64_t len_output_data = 0;
+            uint64_t total_bits = 0;
+
+            uint64_t raw_bytes = 0;
+            uint64_t line_count = 0;
+            uint64_t compressed_bytes = 0;
+            std::vector<uint64_t> newlines;
+            std::vector<std::string_view> block;
+
+            explicit Source(const Stream_Options &options) : compressor(options) {}
+        };
+
+        Stream_Options options;
+        std::vector<std::unique_ptr<Source>> sources;
+
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        // last, so its workers stop before the sources they reference go away
+        Thread_Pool pool;
+
+        void enqueue(Source &source, Batch &&batch);
+        void run(Source &source);
+        void compress_text(Source &source, std::string_view text);
+        void drain(Source &source);
+
+    public:
+        explicit Compressor_Group(unsigned thread_count, const Stream_Options &options = Stream_Options());
+        ~Compressor_Group();
+
+        Compressor_Group(const Compressor_Group &) = delete;
+        Compressor_Group &operator=(const Compressor_Group &) = delete;
+
+        // Creates the archive for a new source and returns its id. Each archive is written through
+        // its own synchronous Output_Sink (GROUP_OUTPUT_CHUNK_SIZE chunks) by the pool workers;
+        // checksums and direct_io are as there.
+        size_t add_source(const std::string &output_path, bool checksums = false, bool direct_io = false);
+
+        // Queues whole lines ('\n' separated; a missing final '\n' is implied). The view must stay
+        // valid until finish(); the std::string overload takes ownership instead.
+        void submit(size_t source_id, std::string_view text);
+        void submit(size_t source_id, std::string &&text);
+
+        // Waits for all queued work, completes every archive and rethrows the first failure.
+        // compressed_bytes() counts an archive without its checksum trailer.
+        void finish();
+
+        size_t size() const { return sources.size(); }
+        uint64_t raw_bytes(size_t source_id) const { return sources[source_id]->raw_bytes; }
+        uint64_t line_count(size_t source_id) const { return sources[source_id]->line_count; }
+        uint64_t compressed_bytes(size_t source_id) const { return sources[source_id]->compressed_bytes; }
+    };
+
+}
+
+#endif
@@ -0,0 +1,119 @@
+#include "ingest_compressor.h"
+
+#include <chrono>
+
+#include "common/trace.h"
+
+namespace XORC
+{
+
+    // Lines are compressed as they are popped, and a popped line only lives until the next pop.
+    static const Stream_Options &lineModeOptions(const Stream_Options &stream_options)
+    {
+        if (stream_options.reorder_block > 0)
+        {
+            throw std::runtime_error("Ingest_Compressor does not reorder blocks.");
+        }
+        return stream_options;
+    }
+
+    Ingest_Compressor::Ingest_Compressor(const char *output_path, const Stream_Options &stream_options, const Ingest_Options &options)
+        : options(options), queue(options.queue_capacity, options.overflow), sc(lineModeOptions(stream_options)), sink(output_path),
+          output_data(2 * OUTPUT_CHUNK_SIZE * 8)
+    {
+        this->sc.write_stream_header(this->output_data, this->len_output_data);
+        this->consumer = std::thread(&Ingest_Compressor::consumer_loop, this);
+    }
+
+    Ingest_Compressor::~Ingest_Compressor()
+    {
+        close();
+    }
+
+    void Ingest_Compressor::compress_line(std::string_view line)
+    {
+        size_t max_record_bits = Stream_Compress::max_record_bits(line.size());
+        if (this->len_output_data + max_record_bits > this->output_data.size())
+        {
+            this->output_data.resize(this->len_output_data + max_record_bits);
+        }
+        this->sc.stream_compress(line, this->output_data, this->len_output_data);
+        this->len_frame_data += line.size() + 1;
+        ++this->line_count;
+    }
+
+    void Ingest_Compressor::write_frame()
+    {
+        this->len_raw_data += this->len_frame_data;
+        this->len_frame_data = 0;
+        this->sink.write_frame(this->output_data, this->len_output_data);
+        ++this->frame_count;
+    }
+
+    void Ingest_Compressor::consumer_loop()
+    {
+        const uint64_t flush_interval = static_cast<uint64_t>(this->options.flush_interval_ms) * 1000000;
+        uint64_t last_flush = traceWallNanos();
+        std::string scratch;
+        std::vector<std::string> spilled;
+        std::string_view line;
+        for (;;)
+        {
+            // read before draining, so nothing logged before close() is left behind
+            const bool is_last = this->stopping.load(std::memory_order_acquire);
+
+            size_t batch_lines = 0;
+            while (batch_lines < INGEST_BATCH_LINES && this->queue.pop(line, scratch))
+            {
+                compress_line(line);
+                ++batch_lines;
+            }
+            this->queue.release();
+            if (this->queue.take_spill(spilled))
+            {
+                for (const std::string &spilled_line : spilled)
+                {
+                    compress_line(spilled_line);
+                }
+                batch_lines += spilled.size();
+            }
+
+            uint64_t now = traceWallNanos();
+            if (this->len_frame_data >= this->options.flush_bytes || (this->len_frame_data > 0 && now - last_flush >= flush_interval))
+            {
+                write_frame();
+                last_flush = now;
+            }
+            else if (this->len_frame_data == 0)
+            {
+                last_flush = now;
+            }
+
+            if (is_last && batch_lines == 0)
+            {
+                break;
+            }
+            if (batch_lines == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(INGEST_IDLE_SLEEP_US));
+            }
+        }
+
+        if (this->len_output_data > 0)
+        {
+            write_frame();
+        }
+    }
+
+    void Ingest_Compressor::close()
+    {
+        if (!this->consumer.joinable())
+        {
+            return;
+        }
+        this->stopping.store(true, std::memory_order_release);
+        this->consumer.join();
+        this->sink.flush();
+    }
+
+}
@@ -0,0 +1,78 @@
+#ifndef XORC_STREAM_COMPRESS_INGEST_COMPRESSOR_H_
+#define XORC_STREAM_COMPRESS_INGEST_COMPRESSOR_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <boost/dynamic_bitset.hpp>
+
+#include "common/constants.h"
+#include "common/ingest_queue.h"
+#include "common/output_sink.h"
+#include "compress/stream_compress.h"
+
+namespace XORC
+{
+
+    struct Ingest_Options
+    {
+        size_t queue_capacity = INGEST_QUEUE_CAPACITY;
+        Overflow_Policy overflow = Overflow_Policy::BLOCK;
+        // a frame is written every flush_bytes of input or flush_interval_ms, whichever comes first
+        uint64_t flush_bytes = 1 << 20;
+        int flush_interval_ms = 1000;
+    };
+
+    // Logging front end for many threads sharing one compressor: log() only appends to an
+    // Ingest_Queue, and a single consumer thread drains it in batches into a Stream_Compress,
+    // writing a framed archive like --follow (decodable up to the last frame at any time).
+    // Line mode only: the constructor throws for a reorder_block.
+    class Ingest_Compressor
+    {
+    private:
+        Ingest_Options options;
+        Ingest_Queue queue;
+        Stream_Compress sc;
+        Output_Sink sink;
+
+        Output_Bitset output_data;
+        uint64_t len_output_data = 0;
+        uint64_t len_frame_data = 0;
+        uint64_t len_raw_data = 0;
+        uint64_t line_count = 0;
+        uint64_t frame_count = 0;
+
+        std::atomic<bool> stopping{false};
+        std::thread consumer;
+
+        void consumer_loop();
+        void compress_line(std::string_view line);
+        void write_frame();
+
+    public:
+        Ingest_Compressor(const char *output_path, const Stream_Options &stream_options, const Ingest_Options &options);
+        // Calls close().
+        ~Ingest_Compressor();
+
+        Ingest_Compressor(const Ingest_Compressor &) = delete;
+        Ingest_Compressor &operator=(const Ingest_Compressor &) = delete;
+
+        // Any thread; the line is copied. Returns false when the overflow policy dropped it.
+        bool log(std::string_view line) { return queue.push(line); }
+
+        // Compresses everything logged so far, writes the last frame and stops the consumer. No
+        // log() may run concurrently with or after it.
+        void close();
+
+        uint64_t get_line_count() const { return line_count; }
+        uint64_t get_raw_bytes() const { return len_raw_data; }
+        uint64_t get_frame_count() const { return frame_count; }
+        uint64_t get_dropped() const { return queue.get_dropped(); }
+        uint64_t get_spilled() const { return queue.get_spilled(); }
+    };
+
+}
+
+#endif
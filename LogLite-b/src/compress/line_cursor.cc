@@ -0,0 +1,41 @@
+#include "line_cursor.h"
+
+namespace XORC
+{
+
+    Line_Cursor::Line_Cursor(const Bit_View &input_data)
+        : owned_decoder(new Stream_Compress()), decoder(*owned_decoder), input_data(input_data)
+    {
+        this->pos = this->decoder.read_stream_header(input_data);
+        this->xor_result.reserve(MAX_LEN);
+    }
+
+    Line_Cursor::Line_Cursor(Stream_Compress &decoder, const Bit_View &input_data, size_t pos)
+        : decoder(decoder), input_data(input_data), pos(pos)
+    {
+        this->xor_result.reserve(MAX_LEN);
+    }
+
+    std::string_view Line_Cursor::next()
+    {
+        ++this->line_count;
+        if (this->decoder.get_reorder_block() == 0)
+        {
+            return this->decoder.decompress_line(this->input_data, this->pos, this->xor_result);
+        }
+
+        if (!this->block || this->block_next == this->block->size())
+        {
+            this->block = &this->decoder.decompress_block(this->input_data, this->pos, this->xor_result);
+            this->block_next = 0;
+        }
+        return (*this->block)[this->block_next++];
+    }
+
+    void Line_Cursor::next_frame(const Bit_View &frame)
+    {
+        this->input_data = frame;
+        this->pos = 0;
+    }
+
+}
@@ -0,0 +1,56 @@
+#ifndef XORC_STREAM_COMPRESS_LINE_CURSOR_H_
+#define XORC_STREAM_COMPRESS_LINE_CURSOR_H_
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+#include "common/bit_view.h"
+#include "compress/stream_compress.h"
+
+namespace XORC
+{
+
+    // Decodes an archive one line at a time, for callers that consume lines in memory:
+    //
+    //     Line_Cursor cursor(view_bitset_in_file(file));
+    //     while (cursor.has_next())
+    //         parse(cursor.next());
+    //
+    // Each view points into the decoder's window (no '\n', no copy) and stays valid until the
+    // next call to next(); in block mode it points into the decoded block.
+    class Line_Cursor
+    {
+    private:
+        std::unique_ptr<Stream_Compress> owned_decoder;
+        Stream_Compress &decoder;
+        Bit_View input_data;
+        size_t pos = 0;
+        std::string xor_result;
+        size_t line_count = 0;
+
+        // block mode: the decoded block and the next line to hand out from it
+        const std::vector<std::string> *block = nullptr;
+        size_t block_next = 0;
+
+    public:
+        explicit Line_Cursor(const Bit_View &input_data);
+        // Continues the stream of a decoder whose header (and window) is already set up, from the
+        // record at pos; bound input_data with a subview to stop early.
+        Line_Cursor(Stream_Compress &decoder, const Bit_View &input_data, size_t pos);
+
+        bool has_next() const { return pos < input_data.size() || (block && block_next < block->size()); }
+        std::string_view next();
+
+        // Continues with the next frame of a framed archive, keeping the window.
+        void next_frame(const Bit_View &frame);
+
+        size_t lines_read() const { return line_count; }
+        // Bit position in the current input after the last record decoded; in block mode, after
+        // the whole block the last line came from.
+        size_t position() const { return pos; }
+    };
+
+}
+
+#endif
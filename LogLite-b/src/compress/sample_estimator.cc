@@ -0,0 +1,319 @@
+#include "sample_estimator.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <limits>
+
+#include "common/huge_pages.h"
+#include "common/trace.h"
+
+namespace XORC
+{
+
+    struct Estimate_Bounds
+    {
+        double estimate = 0;
+        double low = 0;
+        double high = 0;
+    };
+
+    // Two-sided 95% Student t quantiles for 1 to 30 degrees of freedom; ESTIMATE_CONFIDENCE_Z beyond.
+    // A handful of chunks is the common case, and normal bounds would be too narrow there.
+    static const double T_QUANTILES[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    static double confidenceQuantile(size_t degrees_of_freedom)
+    {
+        const size_t count = sizeof(T_QUANTILES) / sizeof(T_QUANTILES[0]);
+        return degrees_of_freedom <= count ? T_QUANTILES[degrees_of_freedom - 1] : ESTIMATE_CONFIDENCE_Z;
+    }
+
+    // sum(y) / sum(x) over the chunks, the chunks being a sample of the file's chunks; the bounds
+    // use the usual variance of a ratio estimator, clamped to [0, upper].
+    template <typename Y, typename X>
+    static Estimate_Bounds ratioBounds(const std::vector<Estimate_Sample> &samples, Y y, X x, double upper = std::numeric_limits<double>::infinity())
+    {
+        double sum_y = 0, sum_x = 0;
+        for (const Estimate_Sample &sample : samples)
+        {
+            sum_y += y(sample);
+            sum_x += x(sample);
+        }
+        Estimate_Bounds bounds;
+        if (sum_x == 0)
+        {
+            return bounds;
+        }
+        bounds.estimate = bounds.low = bounds.high = sum_y / sum_x;
+
+        const size_t n = samples.size();
+        if (n < 2)
+        {
+            return bounds;
+        }
+        double sum_squares = 0;
+        for (const Estimate_Sample &sample : samples)
+        {
+            double residual = y(sample) - bounds.estimate * x(sample);
+            sum_squares += residual * residual;
+        }
+        double margin = confidenceQuantile(n - 1) * std::sqrt(sum_squares / (n - 1) / n) / (sum_x / n);
+        bounds.low = std::max(0.0, bounds.estimate - margin);
+        bounds.high = std::min(upper, bounds.estimate + margin);
+        return bounds;
+    }
+
+    static void writeBounds(std::ostream &os, const Estimate_Bounds &bounds, double scale = 1)
+    {
+        os << "{\"estimate\": " << bounds.estimate * scale << ", \"low\": " << bounds.low * scale << ", \"high\": " << bounds.high * scale << "}";
+    }
+
+    Sample_Estimator::Sample_Estimator(const Stream_Options &options) : options(options)
+    {
+        this->options.reorder_block = 0;
+    }
+
+    void Sample_Estimator::sample_file(const char *filename, double sample_fraction)
+    {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Failed to open file for reading.");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to stat file.");
+        }
+        this->len_file = st.st_size;
+
+        // pread rather than a mapping, so readahead does not pull in more than the chunks
+        const uint64_t budget = static_cast<uint64_t>(this->len_file * sample_fraction);
+        uint64_t chunk_count = ESTIMATE_SAMPLE_CHUNKS;
+        this->len_chunk = std::min(std::max(budget / chunk_count, ESTIMATE_MIN_CHUNK_SIZE), ESTIMATE_MAX_CHUNK_SIZE);
+        chunk_count = std::max<uint64_t>(2, std::min(chunk_count, budget / this->len_chunk));
+        if (2 * chunk_count * this->len_chunk > this->len_file)
+        {
+            chunk_count = 1;
+            this->len_chunk = this->len_file;
+        }
+
+        // appends file[pos, pos + size) to chunk, short at the end of the file
+        std::string chunk;
+        auto read_at = [&](uint64_t pos, size_t size)
+        {
+            size_t len_chunk_data = chunk.size();
+            chunk.resize(len_chunk_data + size);
+            while (size > 0)
+            {
+                ssize_t len_read = pread(fd, &chunk[len_chunk_data], size, pos);
+                if (len_read < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (len_read < 0)
+                {
+                    close(fd);
+                    throw std::runtime_error("Failed to read file.");
+                }
+                if (len_read == 0)
+                {
+                    break;
+                }
+                len_chunk_data += len_read;
+                pos += len_read;
+                size -= len_read;
+            }
+            chunk.resize(len_chunk_data);
+            return size == 0;
+        };
+
+        const uint64_t stride = this->len_file / chunk_count;
+        for (uint64_t i = 0; i < chunk_count; ++i)
+        {
+            // centred in its stride, from the byte before it so a line starting right at it is seen
+            const uint64_t offset = i * stride + (stride - this->len_chunk) / 2;
+            const uint64_t offset_read = offset == 0 ? 0 : offset - 1;
+            chunk.clear();
+            bool is_complete = read_at(offset_read, offset + this->len_chunk - offset_read);
+            // the chunk's last line is read to its end, within ESTIMATE_MAX_CHUNK_SIZE more bytes
+            while (is_complete && !chunk.empty() && chunk.back() != '\n' && chunk.size() < offset + this->len_chunk - offset_read + ESTIMATE_MAX_CHUNK_SIZE)
+            {
+                const size_t len_before = chunk.size();
+                is_complete = read_at(offset_read + len_before, ESTIMATE_MIN_CHUNK_SIZE);
+                const char *newline = static_cast<const char *>(memchr(chunk.data() + len_before, '\n', chunk.size() - len_before));
+                if (newline != nullptr)
+                {
+                    chunk.resize(newline - chunk.data() + 1);
+                    break;
+                }
+            }
+            this->len_read += chunk.size();
+            sample_chunk(chunk.data(), chunk.size(), offset_read);
+        }
+        close(fd);
+    }
+
+    void Sample_Estimator::sample_chunk(const char *data, size_t size, uint64_t offset)
+    {
+        // The lines starting in the chunk, whole: the one it begins inside belongs to the chunk
+        // before, the one it ends inside was read to its end. Dropping both instead would leave
+        // out long lines far more often than short ones.
+        size_t begin = 0;
+        const size_t end = size;
+        if (offset > 0)
+        {
+            const char *newline = static_cast<const char *>(memchr(data, '\n', size));
+            if (newline == nullptr)
+            {
+                return;
+            }
+            begin = newline - data + 1;
+        }
+
+        Stream_Compress sc(this->options);
+        // only the size of each record is kept, so each record overwrites the last
+        Output_Bitset output_data;
+        uint64_t len_output_data = 0;
+
+        Estimate_Sample sample;
+        const size_t len_prime_end = begin + static_cast<size_t>((end - begin) * ESTIMATE_PRIME_SHARE);
+        bool is_measuring = false;
+        uint64_t wall_begin = 0;
+        for (size_t pos = begin; pos < end;)
+        {
+            const char *newline = static_cast<const char *>(memchr(data + pos, '\n', end - pos));
+            const size_t next = newline == nullptr ? end : newline - data + 1;
+            std::string_view line(data + pos, (newline == nullptr ? end : newline - data) - pos);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.remove_suffix(1);
+            }
+
+            if (!is_measuring && pos >= len_prime_end)
+            {
+                is_measuring = true;
+                sample.offset = offset + pos;
+                wall_begin = traceWallNanos();
+            }
+
+            size_t max_record_bits = Stream_Compress::max_record_bits(line.size());
+            if (len_output_data + max_record_bits > output_data.size())
+            {
+                output_data.resize(2 * (len_output_data + max_record_bits));
+            }
+            const uint64_t len_record_begin = len_output_data;
+            const uint64_t xor_record_count = sc.get_xor_record_count();
+            sc.stream_compress(line, output_data, len_output_data);
+
+            if (is_measuring)
+            {
+                const size_t bucket = Compress_Stats::bucket_of(line.size());
+                const uint64_t len_record = len_output_data - len_record_begin;
+                ++sample.lines;
+                sample.bytes += next - pos;
+                sample.compressed_bits += len_record;
+                // a chunked long line is raw only if none of its chunks found a reference
+                sample.raw_lines += sc.get_xor_record_count() == xor_record_count;
+                ++sample.bucket_lines[bucket];
+                sample.bucket_bytes[bucket] += next - pos;
+                sample.bucket_bits[bucket] += len_record;
+            }
+            len_output_data = 0;
+            pos = next;
+        }
+
+        if (sample.lines > 0)
+        {
+            sample.wall_nanos = traceWallNanos() - wall_begin;
+            this->samples.push_back(sample);
+        }
+    }
+
+    void Sample_Estimator::write_json(std::ostream &os) const
+    {
+        uint64_t lines = 0, bytes = 0;
+        for (const Estimate_Sample &sample : this->samples)
+        {
+            lines += sample.lines;
+            bytes += sample.bytes;
+        }
+        auto sample_bytes = [](const Estimate_Sample &sample)
+        {
+            return static_cast<double>(sample.bytes);
+        };
+        auto sample_lines = [](const Estimate_Sample &sample)
+        {
+            return static_cast<double>(sample.lines);
+        };
+
+        Estimate_Bounds ratio = ratioBounds(
+            this->samples, [](const Estimate_Sample &sample)
+            { return sample.compressed_bits / 8.0; },
+            sample_bytes);
+        Estimate_Bounds raw_fraction = ratioBounds(
+            this->samples, [](const Estimate_Sample &sample)
+            { return static_cast<double>(sample.raw_lines); },
+            sample_lines, 1.0);
+        Estimate_Bounds bytes_per_nano = ratioBounds(
+            this->samples, sample_bytes, [](const Estimate_Sample &sample)
+            { return static_cast<double>(sample.wall_nanos); });
+
+        os << "{\n  \"file_bytes\": " << this->len_file
+           << ",\n  \"read_bytes\": " << this->len_read
+           << ",\n  \"read_fraction\": " << static_cast<double>(this->len_read) / std::max<uint64_t>(1, this->len_file)
+           << ",\n  \"chunks\": " << this->samples.size()
+           << ",\n  \"chunk_bytes\": " << this->len_chunk
+           << ",\n  \"measured\": {\"lines\": " << lines << ", \"bytes\": " << bytes << "}";
+        os << ",\n  \"ratio\": ";
+        writeBounds(os, ratio);
+        os << ",\n  \"compressed_bytes\": ";
+        writeBounds(os, ratio, static_cast<double>(this->len_file));
+        os << ",\n  \"raw_fraction\": ";
+        writeBounds(os, raw_fraction);
+        // single-threaded codec speed, reading and writing excluded
+        os << ",\n  \"throughput_mb_s\": ";
+        writeBounds(os, bytes_per_nano, 1e9 / (1024 * 1024));
+
+        os << ",\n  \"length_buckets\": [";
+        bool first = true;
+        for (size_t i = 0; i < STATS_LENGTH_BUCKET_COUNT; ++i)
+        {
+            uint64_t bucket_bytes = 0, bucket_bits = 0;
+            for (const Estimate_Sample &sample : this->samples)
+            {
+                bucket_bytes += sample.bucket_bytes[i];
+                bucket_bits += sample.bucket_bits[i];
+            }
+            if (bucket_bytes == 0)
+            {
+                continue;
+            }
+            Estimate_Bounds line_share = ratioBounds(
+                this->samples, [i](const Estimate_Sample &sample)
+                { return static_cast<double>(sample.bucket_lines[i]); },
+                sample_lines, 1.0);
+            Estimate_Bounds byte_share = ratioBounds(
+                this->samples, [i](const Estimate_Sample &sample)
+                { return static_cast<double>(sample.bucket_bytes[i]); },
+                sample_bytes, 1.0);
+            os << (first ? "\n" : ",\n") << "    {\"min_length\": " << (i == 0 ? 0 : static_cast<size_t>(1) << (i - 1)) << ", \"line_share\": ";
+            writeBounds(os, line_share);
+            os << ", \"byte_share\": ";
+            writeBounds(os, byte_share);
+            os << ", \"ratio\": " << bucket_bits / 8.0 / bucket_bytes << "}";
+            first = false;
+        }
+        os << (first ? "]\n}\n" : "\n  ]\n}\n");
+    }
+
+}
@@ -0,0 +1,55 @@
+#ifndef XORC_STREAM_COMPRESS_SAMPLE_ESTIMATOR_H_
+#define XORC_STREAM_COMPRESS_SAMPLE_ESTIMATOR_H_
+
+#include <ostream>
+#include <vector>
+#include <cstdint>
+
+#include "common/constants.h"
+#include "compress/stream_compress.h"
+#include "compress/compress_stats.h"
+
+namespace XORC
+{
+
+    // What the measured part of one sampled chunk compressed to.
+    struct Estimate_Sample
+    {
+        uint64_t offset = 0;
+        uint64_t lines = 0;
+        uint64_t bytes = 0; // input bytes, line breaks included
+        uint64_t compressed_bits = 0;
+        uint64_t raw_lines = 0; // sent as raw records only
+        uint64_t wall_nanos = 0;
+        uint64_t bucket_lines[STATS_LENGTH_BUCKET_COUNT] = {};
+        uint64_t bucket_bytes[STATS_LENGTH_BUCKET_COUNT] = {};
+        uint64_t bucket_bits[STATS_LENGTH_BUCKET_COUNT] = {};
+    };
+
+    // Predicts how a file would compress from evenly spaced chunks of it. Each chunk gets a fresh
+    // Stream_Compress: its first ESTIMATE_PRIME_SHARE only fills the window, the rest is measured.
+    // Estimates are ratios over the chunks, with 95% t bounds from the spread between chunks. Block reordering is not modelled, lines are compressed one at a time.
+    class Sample_Estimator
+    {
+    private:
+        Stream_Options options;
+        uint64_t len_file = 0;
+        uint64_t len_read = 0;
+        uint64_t len_chunk = 0;
+        std::vector<Estimate_Sample> samples;
+
+        void sample_chunk(const char *data, size_t size, uint64_t offset);
+
+    public:
+        explicit Sample_Estimator(const Stream_Options &options);
+
+        // Reads about sample_fraction of the file, no less than two ESTIMATE_MIN_CHUNK_SIZE chunks,
+        // and all of it when that would be most of it.
+        void sample_file(const char *filename, double sample_fraction = ESTIMATE_SAMPLE_FRACTION);
+
+        void write_json(std::ostream &os) const;
+    };
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "stream_compress.h"
 
+#include <algorithm>
+
 namespace XORC
 {
 
@@ -7,61 +9,551 @@ namespace XORC
 
     static __m128i zero_vec16 = _mm_set1_epi8('\0');
 
-    static boost::dynamic_bitset<> vectorCharToBitset(const std::vector<char> &data)
+    static void integerToBitset(size_t value, Output_Bitset &output_data, uint64_t &len_output_data, size_t bit_count = STREAM_ENCODER_COUNT)
     {
-        boost::dynamic_bitset<> bitset(data.size() * 8);
+        for (size_t i = 0; i < bit_count; ++i)
+        {
+            output_data[len_output_data++] = (value >> i) & 1;
+        }
+    }
 
-        for (size_t i = 0; i < data.size(); ++i)
+    static void writeRawRecord(std::string_view single_data, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        const size_t len_single_data = single_data.size();
+        if (len_single_data > LONG_LINE_LENGTH_ESCAPE)
+        {
+            throw std::runtime_error("A line of 8 MiB or more needs long line chunks.");
+        }
+        output_data[len_output_data++] = 0;
+
+        integerToBitset(len_single_data, output_data, len_output_data, ORIGINAL_LENGTH_COUNT);
+
+        for (size_t i = 0; i < len_single_data; i++)
         {
             for (size_t j = 0; j < 8; ++j)
             {
-                if (data[i] & (1 << j))
-                {
-                    bitset[i * 8 + j] = 1;
-                }
+                output_data[len_output_data++] = (single_data[i] >> j) & 1;
             }
         }
+    }
 
-        return bitset;
+    static size_t bitsetToInteger(const Bit_View &input_data, size_t &pos, size_t bit_count)
+    {
+        size_t value = input_data.bits(pos, bit_count);
+        pos += bit_count;
+        return value;
     }
 
-    static std::vector<char> bitsetToVectorChar(const boost::dynamic_bitset<> &bitset)
+#ifdef XORC_STATS
+    static uint64_t countRunTokens(const std::string &xor_result)
     {
+        uint64_t runs = 0;
+        size_t i = 0;
+        while (i < xor_result.size())
+        {
+            size_t i_len = 0;
+            while (i + i_len < xor_result.size() && xor_result[i + i_len] == '\0' && i_len < RLE_POW_COUNT - 1)
+            {
+                ++i_len;
+            }
+            if (i_len >= RLE_COUNT / 8 + 1)
+            {
+                ++runs;
+                i += i_len;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        return runs;
+    }
+#endif
 
-        std::vector<char> data(bitset.size() / 8);
+    Stream_Compress::Stream_Compress() {}
+    Stream_Compress::Stream_Compress(const Stream_Options &options) : options(options) {}
+    Stream_Compress::~Stream_Compress() {}
 
-        for (size_t i = 0; i < data.size(); ++i)
+    size_t Stream_Compress::max_record_bits(size_t len_single_data)
+    {
+        // 9 bits per literal byte, plus at most as much again for numeric deltas that replace them
+        size_t max_bits = 1 + ORIGINAL_LENGTH_COUNT + EACH_WINDOW_SIZE_COUNT + STREAM_ENCODER_COUNT + 64 + 2 * (RLE_SKIM + 1) * len_single_data;
+        if (len_single_data >= MAX_LEN)
         {
-            char c = 0;
-            for (size_t j = 0; j < 8; ++j)
+            // chunked long lines add a record per chunk, and maybe a gamma coded length
+            max_bits += 2 * 64 + (len_single_data / LONG_LINE_CHUNK_SIZE + 1) * max_record_bits(LONG_LINE_CHUNK_SIZE);
+        }
+        return max_bits;
+    }
+
+    static uint32_t optionFlags(const Stream_Options &options)
+    {
+        uint32_t flags = 0;
+        if (options.numeric_delta)
+        {
+            flags |= STREAM_FLAG_NUMERIC_DELTA;
+        }
+        if (options.window_budget > 0)
+        {
+            flags |= STREAM_FLAG_WINDOW_BUDGET;
+        }
+        if (options.cost_model)
+        {
+            flags |= STREAM_FLAG_COST_MODEL;
+        }
+        if (options.segment_refs)
+        {
+            flags |= STREAM_FLAG_SEGMENT_REFS;
+        }
+        if (options.long_line_chunks)
+        {
+            flags |= STREAM_FLAG_LONG_LINE_CHUNKS;
+        }
+        if (options.reorder_block > 0)
+        {
+            flags |= STREAM_FLAG_REORDER_BLOCKS;
+        }
+        return flags;
+    }
+
+    static void applyOptionFlags(uint64_t flags, Stream_Options &options)
+    {
+        if (flags & ~static_cast<uint64_t>(STREAM_FLAGS_KNOWN))
+        {
+            throw std::runtime_error("Unsupported stream flags.");
+        }
+        options.numeric_delta = flags & STREAM_FLAG_NUMERIC_DELTA;
+        options.cost_model = flags & STREAM_FLAG_COST_MODEL;
+        options.segment_refs = flags & STREAM_FLAG_SEGMENT_REFS;
+        options.long_line_chunks = flags & STREAM_FLAG_LONG_LINE_CHUNKS;
+    }
+
+    void Stream_Compress::write_stream_header(Output_Bitset &output_data, uint64_t &len_output_data) const
+    {
+        uint32_t flags = optionFlags(this->options);
+        if (flags == 0)
+        {
+            return;
+        }
+
+        integerToBitset(STREAM_HEADER_MAGIC, output_data, len_output_data, STREAM_HEADER_MAGIC_COUNT);
+        integerToBitset(STREAM_HEADER_VERSION, output_data, len_output_data, STREAM_HEADER_VERSION_COUNT);
+        integerToBitset(flags, output_data, len_output_data, STREAM_HEADER_FLAGS_COUNT);
+        if (flags & STREAM_FLAG_WINDOW_BUDGET)
+        {
+            writeEliasGamma(this->options.window_budget, output_data, len_output_data);
+        }
+        if (flags & STREAM_FLAG_REORDER_BLOCKS)
+        {
+            writeEliasGamma(this->options.reorder_block, output_data, len_output_data);
+        }
+    }
+
+    size_t Stream_Compress::read_stream_header(const Bit_View &input_data)
+    {
+        this->options = Stream_Options();
+        if (input_data.empty() || !input_data[0])
+        {
+            return 0;
+        }
+
+        size_t pos = 0;
+        if (input_data.size() < STREAM_HEADER_MAGIC_COUNT + STREAM_HEADER_VERSION_COUNT + STREAM_HEADER_FLAGS_COUNT ||
+            bitsetToInteger(input_data, pos, STREAM_HEADER_MAGIC_COUNT) != STREAM_HEADER_MAGIC)
+        {
+            throw std::runtime_error("Unrecognized stream header.");
+        }
+        if (bitsetToInteger(input_data, pos, STREAM_HEADER_VERSION_COUNT) > STREAM_HEADER_VERSION)
+        {
+            throw std::runtime_error("Unsupported stream version.");
+        }
+
+        uint32_t flags = bitsetToInteger(input_data, pos, STREAM_HEADER_FLAGS_COUNT);
+        applyOptionFlags(flags, this->options);
+        if (flags & STREAM_FLAG_WINDOW_BUDGET)
+        {
+            this->options.window_budget = readEliasGamma(input_data, pos);
+        }
+        if (flags & STREAM_FLAG_REORDER_BLOCKS)
+        {
+            this->options.reorder_block = readEliasGamma(input_data, pos);
+        }
+
+        return pos;
+    }
+
+    // magic, version, flags, window budget, bucket count, then per bucket: key, line count, lines.
+    void Stream_Compress::save_window(std::string &snapshot) const
+    {
+        snapshot.clear();
+        writeVarint(snapshot, WINDOW_SNAPSHOT_MAGIC);
+        writeVarint(snapshot, WINDOW_SNAPSHOT_VERSION);
+        writeVarint(snapshot, optionFlags(this->options));
+        writeVarint(snapshot, this->options.window_budget);
+
+        // with a budget the order is the eviction order; otherwise any fixed order will do
+        std::vector<size_t> lengths;
+        if (this->options.window_budget > 0)
+        {
+            lengths.assign(this->window_lru.begin(), this->window_lru.end());
+        }
+        else
+        {
+            for (const auto &bucket : this->window)
             {
-                if (bitset[i * 8 + j])
-                {
-                    c |= (1 << j);
-                }
+                lengths.push_back(bucket.first);
             }
-            data[i] = c;
+            std::sort(lengths.begin(), lengths.end());
         }
 
-        return data;
+        writeVarint(snapshot, lengths.size());
+        for (size_t len_single_data : lengths)
+        {
+            const std::deque<std::string> &bucket = this->window.at(len_single_data);
+            writeVarint(snapshot, len_single_data);
+            writeVarint(snapshot, bucket.size());
+            for (const std::string &line : bucket)
+            {
+                snapshot += line;
+            }
+        }
     }
 
-    static void integerToBitset(size_t value, boost::dynamic_bitset<> &output_data, uint64_t &len_output_data, size_t bit_count = STREAM_ENCODER_COUNT)
+    void Stream_Compress::load_window(std::string_view snapshot)
     {
-        for (size_t i = 0; i < bit_count; ++i)
+        size_t pos = 0;
+        if (readVarint(snapshot, pos) != WINDOW_SNAPSHOT_MAGIC)
         {
-            output_data[len_output_data++] = (value >> i) & 1;
+            throw std::runtime_error("Unrecognized window snapshot.");
+        }
+        if (readVarint(snapshot, pos) > WINDOW_SNAPSHOT_VERSION)
+        {
+            throw std::runtime_error("Unsupported window snapshot version.");
+        }
+        applyOptionFlags(readVarint(snapshot, pos), this->options);
+        this->options.window_budget = readVarint(snapshot, pos);
+
+        this->window.clear();
+        this->window_lru.clear();
+        this->window_lru_position.clear();
+        this->window_bytes = 0;
+
+        uint64_t bucket_count = readVarint(snapshot, pos);
+        for (uint64_t k = 0; k < bucket_count; ++k)
+        {
+            uint64_t key = readVarint(snapshot, pos);
+            uint64_t line_count = readVarint(snapshot, pos);
+            bool is_valid_key = (key > 0 && key < MAX_LEN) || (key >= LONG_LINE_KEY_BASE && key < LONG_LINE_KEY_BASE + LONG_LINE_WINDOW_CHUNKS);
+            size_t len_single_data = bucketLineLength(key);
+            if (!is_valid_key || line_count == 0 || line_count > EACH_WINDOW_SIZE ||
+                this->window.count(key) || snapshot.size() - pos < len_single_data * line_count)
+            {
+                throw std::runtime_error("Malformed window snapshot.");
+            }
+
+            std::deque<std::string> &bucket = this->window[key];
+            for (uint64_t j = 0; j < line_count; ++j)
+            {
+                bucket.emplace_back(snapshot.substr(pos, len_single_data));
+                pos += len_single_data;
+            }
+            this->window_bytes += window_charge(key, line_count);
+
+            if (this->options.window_budget > 0)
+            {
+                this->window_lru_position[key] = this->window_lru.insert(this->window_lru.end(), key);
+            }
+        }
+        if (pos != snapshot.size())
+        {
+            throw std::runtime_error("Malformed window snapshot.");
         }
     }
 
-    Stream_Compress::Stream_Compress() {}
-    Stream_Compress::~Stream_Compress() {}
+    // Window bytes of a bucket of line_count lines, see WINDOW_BUCKET_OVERHEAD.
+    size_t Stream_Compress::window_charge(size_t key, size_t line_count) const
+    {
+        if (line_count == 0)
+        {
+            return 0;
+        }
+        return WINDOW_BUCKET_OVERHEAD + (bucketLineLength(key) + WINDOW_LINE_OVERHEAD) * line_count;
+    }
+
+    // Called after every window change, in the same order by the compressor and the decompressor,
+    // so that both evict exactly the same buckets.
+    void Stream_Compress::update_window_usage(size_t key, size_t len_bucket_before, size_t len_bucket_after)
+    {
+        this->window_bytes += window_charge(key, len_bucket_after) - window_charge(key, len_bucket_before);
+        XORC_STAT(this->stats.window_peak_bytes = std::max<uint64_t>(this->stats.window_peak_bytes, this->window_bytes));
+        XORC_STAT(this->stats.window_bytes = this->window_bytes; this->stats.window_buckets = this->window.size());
+
+        if (this->options.window_budget == 0)
+        {
+            return;
+        }
+
+        auto position = this->window_lru_position.find(key);
+        if (position == this->window_lru_position.end())
+        {
+            this->window_lru_position[key] = this->window_lru.insert(this->window_lru.end(), key);
+        }
+        else
+        {
+            this->window_lru.splice(this->window_lru.end(), this->window_lru, position->second);
+        }
+
+        // the bucket just used is never evicted, even if it alone exceeds the budget
+        while (this->window_bytes > this->options.window_budget && this->window_lru.size() > 1)
+        {
+            size_t evicted = this->window_lru.front();
+            this->window_lru.pop_front();
+            this->window_lru_position.erase(evicted);
+
+            auto bucket = this->window.find(evicted);
+            size_t evicted_bytes = window_charge(evicted, bucket->second.size());
+            this->window_bytes -= evicted_bytes;
+            this->window.erase(bucket);
+            XORC_STAT(++this->stats.evicted_buckets; this->stats.evicted_bytes += evicted_bytes);
+            XORC_STAT(this->stats.window_bytes = this->window_bytes; this->stats.window_buckets = this->window.size());
+        }
+    }
+
+    void Stream_Compress::push_window(size_t key, std::string_view single_data)
+    {
+        std::deque<std::string> &bucket = this->window[key];
+        if (bucket.size() < EACH_WINDOW_SIZE)
+        {
+            bucket.emplace_back(single_data);
+            update_window_usage(key, bucket.size() - 1, bucket.size());
+        }
+        else
+        {
+            bucket.pop_front();
+            bucket.emplace_back(single_data);
+            update_window_usage(key, EACH_WINDOW_SIZE, EACH_WINDOW_SIZE);
+        }
+    }
+
+    // Only a hint: the bucket may still change before that line is reached.
+    void Stream_Compress::prefetch_window(size_t len_single_data) const
+    {
+        auto bucket = this->window.find(len_single_data);
+        if (bucket == this->window.end())
+        {
+            return;
+        }
+
+        const size_t len_prefetch = std::min(len_single_data, BATCH_PREFETCH_BYTES);
+        for (const std::string &candidate : bucket->second)
+        {
+            for (size_t offset = 0; offset < len_prefetch; offset += 64)
+            {
+                __builtin_prefetch(candidate.data() + offset, 0, 1);
+            }
+        }
+    }
+
+    void Stream_Compress::stream_compress_batch(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        if (this->options.reorder_block > 0)
+        {
+            throw std::runtime_error("Lines of a block-reordering stream must be written with stream_compress_block.");
+        }
+        compress_lines(lines, line_count, output_data, len_output_data);
+    }
+
+    void Stream_Compress::compress_lines(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        size_t max_batch_bits = 0;
+        for (size_t i = 0; i < line_count; ++i)
+        {
+            max_batch_bits += max_record_bits(lines[i].size());
+        }
+        if (len_output_data + max_batch_bits > output_data.size())
+        {
+            output_data.resize(len_output_data + max_batch_bits);
+        }
+
+        for (size_t i = 0; i < std::min(line_count, BATCH_PREFETCH_DISTANCE); ++i)
+        {
+            prefetch_window(lines[i].size());
+        }
+        for (size_t i = 0; i < line_count; ++i)
+        {
+            if (i + BATCH_PREFETCH_DISTANCE < line_count)
+            {
+                prefetch_window(lines[i + BATCH_PREFETCH_DISTANCE].size());
+            }
+            compress_line(lines[i], output_data, len_output_data);
+        }
+    }
+
+    static uint64_t similarityKey(std::string_view single_data)
+    {
+        uint64_t key = 0xcbf29ce484222325ULL ^ single_data.size();
+        for (size_t i = 0; i < std::min(single_data.size(), REORDER_PREFIX_BYTES); ++i)
+        {
+            unsigned char c = single_data[i];
+            key = (key ^ (c >= '0' && c <= '9' ? '0' : c)) * 0x100000001b3ULL;
+        }
+        return key;
+    }
+
+    // Stable counting sort of line indices by group.
+    static void groupOrder(const std::vector<uint32_t> &groups, size_t group_count, std::vector<uint32_t> &order)
+    {
+        std::vector<uint32_t> group_begin(group_count + 1, 0);
+        for (uint32_t group : groups)
+        {
+            ++group_begin[group + 1];
+        }
+        for (size_t g = 1; g < group_begin.size(); ++g)
+        {
+            group_begin[g] += group_begin[g - 1];
+        }
+        order.resize(groups.size());
+        for (size_t i = 0; i < groups.size(); ++i)
+        {
+            order[group_begin[groups[i]]++] = i;
+        }
+    }
+
+    // Groups are numbered by first appearance and sent per line, in input order, as the position
+    // of the group in a move-to-front list (Elias gamma, position + 1); the list length itself
+    // means a new group. Lines are then compressed group by group, each group in input order.
+    void Stream_Compress::write_block_order(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        std::unordered_map<uint64_t, uint32_t> group_of_key;
+        this->block_groups.resize(line_count);
+        for (size_t i = 0; i < line_count; ++i)
+        {
+            this->block_groups[i] = group_of_key.emplace(similarityKey(lines[i]), group_of_key.size()).first->second;
+        }
+
+        size_t max_order_bits = (line_count + 1) * (2 * 64);
+        if (len_output_data + max_order_bits > output_data.size())
+        {
+            output_data.resize(len_output_data + max_order_bits);
+        }
+
+        writeEliasGamma(line_count, output_data, len_output_data);
+        std::vector<uint32_t> recent;
+        for (size_t i = 0; i < line_count; ++i)
+        {
+            auto position = std::find(recent.begin(), recent.end(), this->block_groups[i]);
+            writeEliasGamma(position - recent.begin() + 1, output_data, len_output_data);
+            if (position != recent.end())
+            {
+                recent.erase(position);
+            }
+            recent.insert(recent.begin(), this->block_groups[i]);
+        }
+
+        groupOrder(this->block_groups, group_of_key.size(), this->block_order);
+    }
+
+    void Stream_Compress::read_block_order(const Bit_View &input_data, size_t &pos)
+    {
+        size_t line_count = readEliasGamma(input_data, pos);
+        if (line_count > this->options.reorder_block)
+        {
+            throw std::runtime_error("Malformed compressed block.");
+        }
+
+        this->block_groups.resize(line_count);
+        std::vector<uint32_t> recent;
+        for (size_t i = 0; i < line_count; ++i)
+        {
+            size_t position = readEliasGamma(input_data, pos) - 1;
+            if (position > recent.size())
+            {
+                throw std::runtime_error("Malformed compressed block.");
+            }
+            uint32_t group = recent.size();
+            if (position < recent.size())
+            {
+                group = recent[position];
+                recent.erase(recent.begin() + position);
+            }
+            recent.insert(recent.begin(), group);
+            this->block_groups[i] = group;
+        }
+
+        groupOrder(this->block_groups, recent.size(), this->block_order);
+    }
+
+    void Stream_Compress::stream_compress_block(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        if (line_count > this->options.reorder_block)
+        {
+            throw std::runtime_error("A block holds at most reorder_block lines, and only in a block-reordering stream.");
+        }
+        write_block_order(lines, line_count, output_data, len_output_data);
+
+        this->block_views.resize(line_count);
+        for (size_t k = 0; k < line_count; ++k)
+        {
+            this->block_views[k] = lines[this->block_order[k]];
+        }
+        compress_lines(this->block_views.data(), line_count, output_data, len_output_data);
+    }
+
+    void Stream_Compress::stream_compress(std::string_view single_data, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        if (this->options.reorder_block > 0)
+        {
+            throw std::runtime_error("Lines of a block-reordering stream must be written with stream_compress_block.");
+        }
+        compress_line(single_data, output_data, len_output_data);
+    }
+
+    void Stream_Compress::compress_line(std::string_view single_data, Output_Bitset &output_data, uint64_t &len_output_data)
+    {
+        const size_t len_single_data = single_data.size();
+
+        XORC_STAT(Length_Bucket_Stats &line_stats = this->stats.bucket(len_single_data));
+        XORC_STAT(++line_stats.lines; line_stats.bytes += len_single_data);
+
+        if (len_single_data < MAX_LEN || !this->options.long_line_chunks)
+        {
+            encode_line(len_single_data, single_data, output_data, len_output_data);
+            return;
+        }
 
-    void Stream_Compress::stream_compress(const std::string &single_data, boost::dynamic_bitset<> &output_data, uint64_t &len_output_data)
+        // a raw header with the full length, then one record per chunk; the last chunk is aligned
+        // to the end of the line and overlaps the one before it
+        XORC_STAT(++line_stats.chunked_lines; const uint64_t len_header_begin = len_output_data);
+        output_data[len_output_data++] = 0;
+        if (len_single_data < LONG_LINE_LENGTH_ESCAPE)
+        {
+            integerToBitset(len_single_data, output_data, len_output_data, ORIGINAL_LENGTH_COUNT);
+        }
+        else
+        {
+            integerToBitset(LONG_LINE_LENGTH_ESCAPE, output_data, len_output_data, ORIGINAL_LENGTH_COUNT);
+            writeEliasGamma(len_single_data, output_data, len_output_data);
+        }
+        XORC_STAT(line_stats.header_bits += len_output_data - len_header_begin);
+
+        const size_t chunk_count = (len_single_data + LONG_LINE_CHUNK_SIZE - 1) / LONG_LINE_CHUNK_SIZE;
+        for (size_t k = 0; k < chunk_count; ++k)
+        {
+            size_t offset = std::min(k * LONG_LINE_CHUNK_SIZE, len_single_data - LONG_LINE_CHUNK_SIZE);
+            encode_line(longLineChunkKey(k), single_data.substr(offset, LONG_LINE_CHUNK_SIZE), output_data, len_output_data, k * LONG_LINE_CHUNK_SIZE - offset);
+        }
+    }
+
+    // Encodes one record against the window bucket at key, which is the line length except for
+    // the chunks of long lines. A raw record leaves out the first len_chunk_prefix bytes, which
+    // the decoder already has from the chunk before.
+    void Stream_Compress::encode_line(size_t key, std::string_view single_data, Output_Bitset &output_data, uint64_t &len_output_data, size_t len_chunk_prefix)
     {
         const size_t len_single_data = single_data.size();
 
-        if (this->window.find(len_single_data) != this->window.end())
+        XORC_STAT(Length_Bucket_Stats &line_stats = this->stats.bucket(len_single_data));
+
+        if (this->window.find(key) != this->window.end())
         {
             std::string xor_result;
             xor_result.resize(len_single_data);
@@ -74,11 +566,21 @@ namespace XORC
             int count = 0;
             float tem_rate;
 
-            // int i = 0;
-            for (int j = this->window[len_single_data].size() - 1; j >= 0; --j)
+            const size_t segment_count = (len_single_data + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+            if (this->options.segment_refs)
+            {
+                this->segment_zeros.resize(EACH_WINDOW_SIZE * segment_count);
+            }
+            int lowest_scanned = 0;
+
+            Cycle_Timer search_timer(TRACE_CANDIDATE_SEARCH, len_single_data);
+            for (int j = this->window[key].size() - 1; j >= 0; --j)
             {
 
-                XORC::bitwiseXor(single_data, this->window[len_single_data][j], xor_result);
+                XORC::bitwiseXor(single_data, this->window[key][j], xor_result);
+                XORC_STAT(++line_stats.candidates_scanned);
+                lowest_scanned = j;
+                uint16_t *segment_zeros = this->options.segment_refs ? &this->segment_zeros[j * segment_count] : nullptr;
 
                 count = 0;
 
@@ -91,9 +593,15 @@ namespace XORC
 
                     __m256i result = _mm256_cmpeq_epi8(data, zero_vec32);
 
-                    count += _mm_popcnt_u32(_mm256_movemask_epi8(result));
+                    int zeros = _mm_popcnt_u32(_mm256_movemask_epi8(result));
+                    count += zeros;
+                    if (segment_zeros)
+                    {
+                        segment_zeros[i / SEGMENT_SIZE] = zeros;
+                    }
                 }
 
+                const int count_before_tail = count;
                 for (; i < len_single_data; ++i)
                 {
                     if (xor_result[i] == '\0')
@@ -101,6 +609,10 @@ namespace XORC
                         ++count;
                     }
                 }
+                if (segment_zeros && len_single_data % SEGMENT_SIZE)
+                {
+                    segment_zeros[segment_count - 1] = count - count_before_tail;
+                }
 
                 tem_rate = 1.0f - static_cast<float>(count) / len_single_data;
 
@@ -112,11 +624,42 @@ namespace XORC
 
                     if (min_compress_rate <= 0.15)
                     {
+                        XORC_STAT(++line_stats.early_exits);
                         break;
                     }
                 }
             }
+            search_timer.stop();
 
+            if (this->options.segment_refs)
+            {
+                choose_segment_references(len_single_data, key, min_index, lowest_scanned);
+                if (!this->segment_switches.empty())
+                {
+                    // keep the switches only if they pay for themselves
+                    size_t len_single_estimate = XORC::runLengthEncodedLength(min_xor_result);
+                    XORC::bitwiseXor(single_data, reference_line(key, min_index), xor_result);
+                    size_t len_segment_estimate = XORC::runLengthEncodedLength(xor_result);
+                    for (size_t k = 0; k < this->segment_switches.size(); ++k)
+                    {
+                        uint32_t previous = k == 0 ? 0 : this->segment_switches[k - 1].first;
+                        len_segment_estimate += eliasGammaLength(this->segment_switches[k].first - previous) + EACH_WINDOW_SIZE_COUNT;
+                    }
+
+                    if (len_segment_estimate < len_single_estimate)
+                    {
+                        min_xor_result.swap(xor_result);
+                    }
+                    else
+                    {
+                        this->segment_switches.clear();
+                    }
+                }
+            }
+            const std::string &reference = reference_line(key, min_index);
+
+            Cycle_Timer encode_timer(TRACE_RLE_ENCODE, len_single_data);
+            const uint64_t len_record_begin = len_output_data;
             output_data[len_output_data++] = 1;
 
             integerToBitset(min_index, output_data, len_output_data, EACH_WINDOW_SIZE_COUNT);
@@ -124,74 +667,122 @@ namespace XORC
             size_t tem_index = len_output_data;
             len_output_data += STREAM_ENCODER_COUNT;
 
-            size_t len_xor_rle_bitset = XORC::runLengthEncodeString(min_xor_result, output_data, len_output_data, single_data);
+            size_t len_xor_rle_bitset = 0;
+            size_t len_switch_bitset = 0;
+            if (this->options.segment_refs)
+            {
+                const uint64_t len_switches_begin = len_output_data;
+                writeEliasGamma(this->segment_switches.size() + 1, output_data, len_output_data);
+                uint32_t previous = 0;
+                for (const auto &segment_switch : this->segment_switches)
+                {
+                    writeEliasGamma(segment_switch.first - previous, output_data, len_output_data);
+                    integerToBitset(segment_switch.second, output_data, len_output_data, EACH_WINDOW_SIZE_COUNT);
+                    previous = segment_switch.first;
+                }
+                len_switch_bitset = len_output_data - len_switches_begin;
+                len_xor_rle_bitset += len_switch_bitset;
+                XORC_STAT(line_stats.segment_switches += this->segment_switches.size());
+            }
+            if (this->options.numeric_delta)
+            {
+                len_xor_rle_bitset += XORC::numericDeltaEncode(single_data, reference, min_xor_result, output_data, len_output_data);
+            }
+            XORC_STAT(const size_t len_numeric_bitset = len_xor_rle_bitset - len_switch_bitset);
 
-            for (size_t i = 0; i < STREAM_ENCODER_COUNT; ++i)
+            bool use_bitmask = false;
+            if (this->options.cost_model)
             {
-                output_data[tem_index + i] = (len_xor_rle_bitset >> i) & 1;
+                // exact payload sizes; a raw record wins when neither XOR encoding is shorter
+                size_t len_rle_estimate = XORC::runLengthEncodedLength(min_xor_result);
+                size_t len_bitmask_estimate = 1 + RLE_COUNT + XORC::bitmaskEncodedLength(min_xor_result);
+                use_bitmask = len_bitmask_estimate < len_rle_estimate;
+
+                size_t len_xor_record = len_output_data - len_record_begin + std::min(len_rle_estimate, len_bitmask_estimate);
+                if (len_xor_record > 1 + ORIGINAL_LENGTH_COUNT + 8 * (len_single_data - len_chunk_prefix))
+                {
+                    encode_timer.stop();
+                    XORC_STAT(++line_stats.raw_cheaper);
+                    XORC_STAT(line_stats.header_bits += 1 + ORIGINAL_LENGTH_COUNT; line_stats.payload_bits += 8 * (len_single_data - len_chunk_prefix));
+
+                    Cycle_Timer packing_timer(TRACE_BIT_PACKING, len_single_data);
+                    len_output_data = len_record_begin;
+                    writeRawRecord(single_data.substr(len_chunk_prefix), output_data, len_output_data);
+                    packing_timer.stop();
+
+                    Cycle_Timer window_timer(TRACE_WINDOW_UPDATE, len_single_data);
+                    push_window(key, single_data);
+                    return;
+                }
+
+                if (use_bitmask)
+                {
+                    integerToBitset(0, output_data, len_output_data, 1 + RLE_COUNT);
+                    len_xor_rle_bitset += 1 + RLE_COUNT;
+                }
             }
 
-            if (this->window[len_single_data].size() < EACH_WINDOW_SIZE)
+            XORC_STAT(line_stats.numeric_delta_bits += len_numeric_bitset);
+            size_t len_rle_bitset = use_bitmask ? XORC::bitmaskEncodeString(min_xor_result, output_data, len_output_data, single_data)
+                                                : XORC::runLengthEncodeString(min_xor_result, output_data, len_output_data, single_data);
+            len_xor_rle_bitset += len_rle_bitset;
+
+            ++this->xor_record_count;
+            XORC_STAT(++line_stats.xor_records; ++line_stats.window_index[min_index]);
+            XORC_STAT(line_stats.header_bits += 1 + EACH_WINDOW_SIZE_COUNT + STREAM_ENCODER_COUNT; line_stats.payload_bits += len_rle_bitset);
+            XORC_STAT(line_stats.header_bits += len_xor_rle_bitset - len_rle_bitset - len_numeric_bitset);
+            if (use_bitmask)
             {
-                this->window[len_single_data].push_back(single_data);
+                XORC_STAT(++line_stats.bitmask_records);
             }
             else
             {
-                this->window[len_single_data].pop_front();
-                this->window[len_single_data].push_back(single_data);
+                XORC_STAT(uint64_t run_tokens = countRunTokens(min_xor_result));
+                XORC_STAT(line_stats.run_tokens += run_tokens; line_stats.literal_tokens += len_rle_bitset / (1 + RLE_SKIM) - run_tokens);
             }
+
+            for (size_t i = 0; i < STREAM_ENCODER_COUNT; ++i)
+            {
+                output_data[tem_index + i] = (len_xor_rle_bitset >> i) & 1;
+            }
+            encode_timer.stop();
+
+            Cycle_Timer window_timer(TRACE_WINDOW_UPDATE, len_single_data);
+            push_window(key, single_data);
         }
         else if (len_single_data >= MAX_LEN || len_single_data == 0)
         {
-            output_data[len_output_data++] = 0;
+            XORC_STAT(len_single_data == 0 ? ++line_stats.raw_empty : ++line_stats.raw_oversize);
+            XORC_STAT(line_stats.header_bits += 1 + ORIGINAL_LENGTH_COUNT; line_stats.payload_bits += 8 * len_single_data);
 
-            integerToBitset(len_single_data, output_data, len_output_data, ORIGINAL_LENGTH_COUNT);
-
-            for (size_t i = 0; i < len_single_data; i++)
-            {
-                for (size_t j = 0; j < 8; ++j)
-                {
-                    output_data[len_output_data++] = (single_data[i] >> j) & 1;
-                }
-            }
+            Cycle_Timer packing_timer(TRACE_BIT_PACKING, len_single_data);
+            writeRawRecord(single_data, output_data, len_output_data);
         }
         else
         {
+            Cycle_Timer window_timer(TRACE_WINDOW_UPDATE, len_single_data);
             std::deque<std::string> newDeque;
-            newDeque.push_back(single_data);
-            this->window[len_single_data] = newDeque;
+            newDeque.emplace_back(single_data);
+            this->window[key] = newDeque;
+            update_window_usage(key, 0, 1);
+            window_timer.stop();
 
-            output_data[len_output_data++] = 0;
+            XORC_STAT(++line_stats.raw_first_seen);
+            XORC_STAT(line_stats.header_bits += 1 + ORIGINAL_LENGTH_COUNT; line_stats.payload_bits += 8 * (len_single_data - len_chunk_prefix));
 
-            integerToBitset(len_single_data, output_data, len_output_data, ORIGINAL_LENGTH_COUNT);
-
-            for (size_t i = 0; i < len_single_data; i++)
-            {
-                for (size_t j = 0; j < 8; ++j)
-                {
-                    output_data[len_output_data++] = (single_data[i] >> j) & 1;
-                }
-            }
+            Cycle_Timer packing_timer(TRACE_BIT_PACKING, len_single_data);
+            writeRawRecord(single_data.substr(len_chunk_prefix), output_data, len_output_data);
         }
     }
 
-    static std::string bitsetToString(const boost::dynamic_bitset<> &bitset)
+    static std::string bitsetToString(const Bit_View &bitset)
     {
 
         std::string data;
         data.resize(bitset.size() / 8);
-        char c = 0;
         for (size_t i = 0; i < data.size(); ++i)
         {
-            c = 0;
-            for (size_t j = 0; j < 8; ++j)
-            {
-                if (bitset[i * 8 + j])
-                {
-                    c |= (1 << j);
-                }
-            }
-            data[i] = c;
+            data[i] = bitset.bits(i * 8, 8);
         }
 
         return data;
@@ -243,7 +834,87 @@ namespace XORC
         }
     }
 
-    void Stream_Compress::stream_decompress(const boost::dynamic_bitset<> &single_data, const bool isRLE, const int original_length_or_window_id, std::string &output_data, std::string &xor_result)
+    void Stream_Compress::stream_decompress(const Bit_View &single_data, const bool isRLE, const int original_length_or_window_id, std::string &output_data, std::string &xor_result)
+    {
+        output_data += decode_line(single_data, isRLE, original_length_or_window_id, xor_result);
+        output_data += "\n";
+        // output_data += "\r\n";
+    }
+
+    // Per segment, take the candidate with the most matching bytes unless the current reference
+    // is within SEGMENT_SWITCH_MIN_GAIN of it; segment 0 always uses the record's window id.
+    void Stream_Compress::choose_segment_references(size_t len_single_data, size_t key, int min_index, int lowest_scanned)
+    {
+        this->segment_switches.clear();
+        const size_t segment_count = (len_single_data + SEGMENT_SIZE - 1) / SEGMENT_SIZE;
+        const int newest = this->window[key].size() - 1;
+        int current = min_index;
+        for (size_t s = 1; s < segment_count; ++s)
+        {
+            int best = current;
+            for (int j = newest; j >= lowest_scanned; --j)
+            {
+                if (this->segment_zeros[j * segment_count + s] > this->segment_zeros[best * segment_count + s])
+                {
+                    best = j;
+                }
+            }
+            if (this->segment_zeros[best * segment_count + s] >= this->segment_zeros[current * segment_count + s] + SEGMENT_SWITCH_MIN_GAIN)
+            {
+                this->segment_switches.emplace_back(s, best);
+                current = best;
+            }
+        }
+    }
+
+    const std::string &Stream_Compress::reference_line(size_t key, int window_id)
+    {
+        std::deque<std::string> &bucket = this->window[key];
+        if (this->segment_switches.empty())
+        {
+            return bucket[window_id];
+        }
+
+        this->segment_reference = bucket[window_id];
+        const size_t len_single_data = this->segment_reference.size();
+        for (size_t k = 0; k < this->segment_switches.size(); ++k)
+        {
+            size_t begin = this->segment_switches[k].first * SEGMENT_SIZE;
+            size_t end = k + 1 < this->segment_switches.size() ? this->segment_switches[k + 1].first * SEGMENT_SIZE : len_single_data;
+            if (this->segment_switches[k].second >= bucket.size() || end > len_single_data || begin >= end)
+            {
+                throw std::runtime_error("Invalid segment reference");
+            }
+            this->segment_reference.replace(begin, end - begin, bucket[this->segment_switches[k].second], begin, end - begin);
+        }
+        return this->segment_reference;
+    }
+
+    std::string_view Stream_Compress::store_decoded_line(size_t key, std::string &xor_result)
+    {
+        std::deque<std::string> &bucket = this->window[key];
+        if (bucket.size() < EACH_WINDOW_SIZE)
+        {
+            bucket.push_back(xor_result);
+            update_window_usage(key, bucket.size() - 1, bucket.size());
+        }
+        else
+        {
+            std::string recycled;
+            recycled.swap(bucket.front());
+            bucket.pop_front();
+            bucket.push_back(std::move(xor_result));
+            xor_result.swap(recycled);
+            update_window_usage(key, EACH_WINDOW_SIZE, EACH_WINDOW_SIZE);
+        }
+        return bucket.back();
+    }
+
+    // The reconstructed line goes into the window without a copy: once a bucket is full, the
+    // evicted line's buffer is handed back through xor_result for the next line of that size.
+    // A key of 0 means the bucket of the line's own length; raw chunk records only carry the bytes
+    // after chunk_prefix.
+    std::string_view Stream_Compress::decode_line(const Bit_View &single_data, const bool isRLE, const int original_length_or_window_id, std::string &xor_result, size_t key, std::string_view chunk_prefix)
     {
         xor_result.clear();
         if (isRLE)
@@ -252,10 +923,48 @@ namespace XORC
             size_t len_single_data = single_data.size();
             size_t i = 0;
 
+            if (this->options.segment_refs)
+            {
+                size_t switch_count = readEliasGamma(single_data, i) - 1;
+                this->segment_switches.resize(switch_count);
+                uint32_t segment = 0;
+                for (auto &segment_switch : this->segment_switches)
+                {
+                    segment += readEliasGamma(single_data, i);
+                    segment_switch.first = segment;
+                    segment_switch.second = single_data.bits(i, EACH_WINDOW_SIZE_COUNT);
+                    i += EACH_WINDOW_SIZE_COUNT;
+                }
+            }
+
+            if (this->options.numeric_delta)
+            {
+                XORC::numericDeltaRead(single_data, i, this->numeric_deltas);
+            }
+
+            if (this->options.cost_model && len_single_data - i >= 1 + RLE_COUNT && single_data.bits(i, 1 + RLE_COUNT) == 0)
+            {
+                i += 1 + RLE_COUNT;
+                Cycle_Timer decode_timer(TRACE_RLE_DECODE, len_single_data / 8);
+                size_t changed_count;
+                size_t len_line = XORC::bitmaskLineLength(single_data, i, changed_count);
+                key = key ? key : len_line;
+                const std::string &pattern = reference_line(key, original_length_or_window_id);
+                XORC::bitmaskDecodeString(single_data, i, changed_count, pattern, xor_result, this->changed_bytes);
+                decode_timer.stop();
+
+                if (this->options.numeric_delta)
+                {
+                    XORC::numericDeltaApply(pattern, this->numeric_deltas, xor_result);
+                }
+                return store_decoded_line(key, xor_result);
+            }
+
             int zero_count = 0;
 
             unsigned char byte = 0;
 
+            Cycle_Timer decode_timer(TRACE_RLE_DECODE, len_single_data / 8);
             while (i < len_single_data)
             {
 
@@ -263,11 +972,7 @@ namespace XORC
                 {
                     i++;
 
-                    byte = 0;
-                    for (std::size_t j = 0; j < 8; ++j)
-                    {
-                        byte |= (single_data[i + j]) << j;
-                    }
+                    byte = single_data.bits(i, 8);
                     i += RLE_SKIM;
 
                     xor_result.push_back(byte);
@@ -276,53 +981,173 @@ namespace XORC
                 {
                     i++;
 
-                    zero_count = 0;
-                    for (size_t j = 0; j < RLE_COUNT; ++j, ++i)
-                    {
-                        if (single_data[i])
-                        {
-                            zero_count |= (1 << j);
-                        }
-                    }
+                    zero_count = single_data.bits(i, RLE_COUNT);
+                    i += RLE_COUNT;
 
                     xor_result.append(zero_count, '\0');
                 }
             }
 
+            decode_timer.stop();
+
+            Cycle_Timer reconstruct_timer(TRACE_RECONSTRUCT, xor_result.size());
             int len_xor_result = xor_result.size();
-            std::string &pattern = this->window[len_xor_result][original_length_or_window_id];
+            key = key ? key : len_xor_result;
+            const std::string &pattern = reference_line(key, original_length_or_window_id);
 
             simdReplaceNullCharacters(xor_result, pattern);
 
-            output_data += xor_result;
-            output_data += "\n";
-            // output_data += "\r\n";
-
-            if (this->window[len_xor_result].size() < EACH_WINDOW_SIZE)
-            {
-                this->window[len_xor_result].push_back(xor_result);
-            }
-            else
+            if (this->options.numeric_delta)
             {
-                this->window[len_xor_result].pop_front();
-                this->window[len_xor_result].push_back(xor_result);
+                XORC::numericDeltaApply(pattern, this->numeric_deltas, xor_result);
             }
+
+            return store_decoded_line(key, xor_result);
         }
         else
         {
 
+            Cycle_Timer packing_timer(TRACE_BIT_PACKING, single_data.size() / 8);
             std::string tem = bitsetToString(single_data);
-            output_data += tem;
-            output_data += "\n";
-            // output_data += "\r\n";
 
-            if (original_length_or_window_id < MAX_LEN)
+            if (key)
+            {
+                tem.insert(0, chunk_prefix);
+                push_window(key, tem);
+                return this->window[key].back();
+            }
+
+            // mirrors stream_compress, which never opens a bucket for empty lines
+            if (original_length_or_window_id > 0 && original_length_or_window_id < MAX_LEN && this->window.count(original_length_or_window_id))
+            {
+                // the cost model sends raw records for lengths already in the window
+                push_window(original_length_or_window_id, tem);
+                return this->window[original_length_or_window_id].back();
+            }
+            if (original_length_or_window_id > 0 && original_length_or_window_id < MAX_LEN)
             {
                 std::deque<std::string> newDeque;
-                newDeque.push_back(tem);
-                this->window[original_length_or_window_id] = newDeque;
+                newDeque.push_back(std::move(tem));
+                this->window[original_length_or_window_id] = std::move(newDeque);
+                update_window_usage(original_length_or_window_id, 0, 1);
+                return this->window[original_length_or_window_id].back();
+            }
+
+            this->unstored_line = std::move(tem);
+            return this->unstored_line;
+        }
+    }
+
+    std::string_view Stream_Compress::decompress_line(const Bit_View &input_data, size_t &pos, std::string &xor_result)
+    {
+        return decode_record(input_data, pos, xor_result, 0);
+    }
+
+    // original_length is the header's ORIGINAL_LENGTH_COUNT bit field, pos just after it.
+    size_t Stream_Compress::read_long_line_length(const Bit_View &input_data, size_t &pos, size_t original_length) const
+    {
+        if (original_length != LONG_LINE_LENGTH_ESCAPE)
+        {
+            return original_length;
+        }
+        size_t len_line = readEliasGamma(input_data, pos);
+        // every chunk takes at least a bit
+        if (len_line < LONG_LINE_LENGTH_ESCAPE || len_line / LONG_LINE_CHUNK_SIZE > input_data.size() - pos)
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        return len_line;
+    }
+
+    std::string_view Stream_Compress::decode_long_line(const Bit_View &input_data, size_t &pos, size_t len_line, std::string &xor_result)
+    {
+        std::string &line = this->unstored_line;
+        line.resize(len_line);
+
+        const size_t chunk_count = (len_line + LONG_LINE_CHUNK_SIZE - 1) / LONG_LINE_CHUNK_SIZE;
+        for (size_t k = 0; k < chunk_count; ++k)
+        {
+            if (pos >= input_data.size())
+            {
+                throw std::runtime_error("Malformed compressed record.");
             }
+            size_t offset = std::min(k * LONG_LINE_CHUNK_SIZE, len_line - LONG_LINE_CHUNK_SIZE);
+            std::string_view chunk_prefix = std::string_view(line).substr(offset, k * LONG_LINE_CHUNK_SIZE - offset);
+            std::string_view chunk = decode_record(input_data, pos, xor_result, longLineChunkKey(k), chunk_prefix);
+            if (chunk.size() != LONG_LINE_CHUNK_SIZE)
+            {
+                throw std::runtime_error("Malformed compressed record.");
+            }
+            line.replace(offset, LONG_LINE_CHUNK_SIZE, chunk);
         }
+        return line;
+    }
+
+    std::string_view Stream_Compress::decode_record(const Bit_View &input_data, size_t &pos, std::string &xor_result, size_t key, std::string_view chunk_prefix)
+    {
+        Cycle_Timer parse_timer(TRACE_PARSE, 0);
+        if (input_data[pos++] == 0)
+        {
+            if (input_data.size() - pos < ORIGINAL_LENGTH_COUNT)
+            {
+                throw std::runtime_error("Malformed compressed record.");
+            }
+            size_t original_length = bitsetToInteger(input_data, pos, ORIGINAL_LENGTH_COUNT);
+            if (key == 0 && original_length >= MAX_LEN && this->options.long_line_chunks)
+            {
+                size_t len_line = read_long_line_length(input_data, pos, original_length);
+                parse_timer.stop();
+                return decode_long_line(input_data, pos, len_line, xor_result);
+            }
+            if (key && original_length + chunk_prefix.size() != LONG_LINE_CHUNK_SIZE)
+            {
+                throw std::runtime_error("Malformed compressed record.");
+            }
+            if (input_data.size() - pos < original_length * 8)
+            {
+                throw std::runtime_error("Malformed compressed record.");
+            }
+            pos += original_length * 8;
+            parse_timer.stop();
+            return decode_line(input_data.subview(pos - original_length * 8, original_length * 8), false, original_length, xor_result, key, chunk_prefix);
+        }
+
+        if (input_data.size() - pos < EACH_WINDOW_SIZE_COUNT + STREAM_ENCODER_COUNT)
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        int window_id = bitsetToInteger(input_data, pos, EACH_WINDOW_SIZE_COUNT);
+        size_t len_single_data = bitsetToInteger(input_data, pos, STREAM_ENCODER_COUNT);
+        if (input_data.size() - pos < len_single_data)
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        pos += len_single_data;
+        parse_timer.stop();
+        return decode_line(input_data.subview(pos - len_single_data, len_single_data), true, window_id, xor_result, key);
+    }
+
+    const std::vector<std::string> &Stream_Compress::decompress_block(const Bit_View &input_data, size_t &pos, std::string &xor_result)
+    {
+        read_block_order(input_data, pos);
+
+        this->block_lines.resize(this->block_order.size());
+        for (uint32_t line_index : this->block_order)
+        {
+            if (pos >= input_data.size())
+            {
+                throw std::runtime_error("Malformed compressed block.");
+            }
+            this->block_lines[line_index].assign(decompress_line(input_data, pos, xor_result));
+        }
+        return this->block_lines;
+    }
+
+    size_t Stream_Compress::decompress_record(const Bit_View &input_data, size_t pos, std::string &output_data, std::string &xor_result)
+    {
+        output_data += decompress_line(input_data, pos, xor_result);
+        output_data += "\n";
+        return pos;
     }
 
 }
\ No newline at end of file
@@ -2,33 +2,164 @@
 #define XORC_STREAM_COMPRESS_COMPRESS_H_
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <sstream>
 #include <fstream>
 #include <iostream>
 #include <boost/dynamic_bitset.hpp>
 #include <deque>
+#include <list>
 #include <unordered_map>
 #include <chrono>
+#include <algorithm>
 
 #include "common/xor_string.h"
 #include "common/rle.h"
+#include "common/bitmask.h"
 #include "common/constants.h"
+#include "common/numeric_delta.h"
+#include "common/bit_coding.h"
+#include "common/bit_view.h"
+#include "common/trace.h"
+#include "compress/compress_stats.h"
 
 namespace XORC
 {
 
+    struct Stream_Options
+    {
+        // Send changed decimal/hex/clock fields as deltas against the reference line.
+        bool numeric_delta = false;
+        // Upper bound on the bytes of history kept in the window; 0 means unbounded. Whole length
+        // buckets are dropped, least recently used first. Besides the line bytes, the window is
+        // charged a fixed WINDOW_BUCKET_OVERHEAD per bucket and WINDOW_LINE_OVERHEAD per line.
+        size_t window_budget = 0;
+        // Emit whichever of raw, XOR-RLE and XOR-bitmask is shortest for each line.
+        bool cost_model = false;
+        // Let each SEGMENT_SIZE segment of a line use its own reference from the window.
+        bool segment_refs = false;
+        // Split lines of MAX_LEN bytes or more into LONG_LINE_CHUNK_SIZE chunks that are matched
+        // against the chunks at the same index of earlier long lines.
+        bool long_line_chunks = false;
+        // Lines per reordering block; 0 keeps the input order. Within a block, lines of the same
+        // similarity group are compressed next to each other and decoded back in input order.
+        size_t reorder_block = 0;
+    };
+
+    // Window keys at and above LONG_LINE_KEY_BASE hold the chunks of long lines, one per chunk
+    // index; chunks past LONG_LINE_WINDOW_CHUNKS share the last key.
+    inline size_t longLineChunkKey(size_t chunk_index)
+    {
+        return LONG_LINE_KEY_BASE + std::min(chunk_index, LONG_LINE_WINDOW_CHUNKS - 1);
+    }
+
+    inline size_t bucketLineLength(size_t key)
+    {
+        return key >= LONG_LINE_KEY_BASE ? LONG_LINE_CHUNK_SIZE : key;
+    }
+
     class Stream_Compress
     {
+        // walks the stream with the adopted options and block orders, without a window of bytes
+        friend class Stream_Summary;
+
     private:
+        // keyed by line length; chunks of long lines use keys from LONG_LINE_KEY_BASE up
         std::unordered_map<size_t, std::deque<std::string>> window;
+        Stream_Options options;
+
+        size_t window_bytes = 0;
+        uint64_t xor_record_count = 0;
+        // keys in the window, least recently used first (only kept with a window budget)
+        std::list<size_t> window_lru;
+        std::unordered_map<size_t, std::list<size_t>::iterator> window_lru_position;
+
+        size_t window_charge(size_t key, size_t line_count) const;
+        void update_window_usage(size_t key, size_t len_bucket_before, size_t len_bucket_after);
+        void prefetch_window(size_t len_single_data) const;
+        void push_window(size_t key, std::string_view single_data);
+        std::string_view store_decoded_line(size_t key, std::string &xor_result);
+        void choose_segment_references(size_t len_single_data, size_t key, int min_index, int lowest_scanned);
+        const std::string &reference_line(size_t key, int window_id);
+        void encode_line(size_t key, std::string_view single_data, Output_Bitset &output_data, uint64_t &len_output_data, size_t len_chunk_prefix = 0);
+        std::string_view decode_line(const Bit_View &single_data, const bool isRLE, const int window_id, std::string &xor_result, size_t key = 0,
+                                     std::string_view chunk_prefix = {});
+        std::string_view decode_record(const Bit_View &input_data, size_t &pos, std::string &xor_result, size_t key, std::string_view chunk_prefix = {});
+        size_t read_long_line_length(const Bit_View &input_data, size_t &pos, size_t original_length) const;
+        std::string_view decode_long_line(const Bit_View &input_data, size_t &pos, size_t len_line, std::string &xor_result);
+
+        std::vector<std::pair<uint32_t, int64_t>> numeric_deltas;
+        // decoded lines the window does not keep (empty or >= MAX_LEN), also where long lines are reassembled
+        std::string unstored_line;
+        std::string changed_bytes;
+
+        // per-segment references: zero counts per (candidate, segment) from the window scan, the
+        // switches chosen for the current line and the composite reference they describe
+        std::vector<uint16_t> segment_zeros;
+        std::vector<std::pair<uint32_t, uint32_t>> segment_switches;
+        std::string segment_reference;
+
+        // block reordering: group of each line, the clustered order and the decoded block
+        std::vector<uint32_t> block_groups;
+        std::vector<uint32_t> block_order;
+        std::vector<std::string_view> block_views;
+        std::vector<std::string> block_lines;
+
+        void write_block_order(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data);
+        // one record per line, whatever the mode; the public entry points check the mode first
+        void compress_line(std::string_view single_data, Output_Bitset &output_data, uint64_t &len_output_data);
+        void compress_lines(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data);
+        void read_block_order(const Bit_View &input_data, size_t &pos);
+
+#ifdef XORC_STATS
+        Compress_Stats stats;
+#endif
 
     public:
         Stream_Compress();
+        explicit Stream_Compress(const Stream_Options &options);
         ~Stream_Compress();
 
-        void stream_compress(const std::string &single_data, boost::dynamic_bitset<> &output_data, uint64_t &len_output_data);
-        void stream_decompress(const boost::dynamic_bitset<> &single_data, const bool isRLE, const int window_id, std::string &output_data, std::string &xor_result);
+        // Upper bound on the bits stream_compress appends for a line of this length.
+        static size_t max_record_bits(size_t len_single_data);
+
+        // Writes nothing for default options, which keeps the legacy stream layout.
+        void write_stream_header(Output_Bitset &output_data, uint64_t &len_output_data) const;
+        // Returns the number of header bits (0 for a legacy stream) and adopts the stored options.
+        size_t read_stream_header(const Bit_View &input_data);
+
+        size_t get_window_bytes() const { return window_bytes; }
+        // XOR records written so far, long line chunks included; a line that adds none went out raw.
+        uint64_t get_xor_record_count() const { return xor_record_count; }
+        size_t get_reorder_block() const { return options.reorder_block; }
+
+#ifdef XORC_STATS
+        const Compress_Stats &get_stats() const { return stats; }
+#endif
+
+        // Versioned binary copy of the options and the window (buckets in eviction order), so a
+        // restarted compressor can continue an archive with the same context.
+        void save_window(std::string &snapshot) const;
+        void load_window(std::string_view snapshot);
+
+        // Line mode only (reorder_block == 0); throws in block mode, where every line must be part
+        // of a block.
+        void stream_compress(std::string_view single_data, Output_Bitset &output_data, uint64_t &len_output_data);
+        // Same output as calling stream_compress for each line in turn, but grows output_data once
+        // and prefetches the window candidates of upcoming lines while the current one is encoded.
+        void stream_compress_batch(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data);
+        // Block mode only: writes one block holding these lines (at most reorder_block of them).
+        void stream_compress_block(const std::string_view *lines, size_t line_count, Output_Bitset &output_data, uint64_t &len_output_data);
+        void stream_decompress(const Bit_View &single_data, const bool isRLE, const int window_id, std::string &output_data, std::string &xor_result);
+        // Decodes the record starting at pos and returns the position after it.
+        size_t decompress_record(const Bit_View &input_data, size_t pos, std::string &output_data, std::string &xor_result);
+        // Decodes the record at pos, advancing pos past it. The line is not copied out: the view
+        // points into the window and stays valid until the next decode.
+        std::string_view decompress_line(const Bit_View &input_data, size_t &pos, std::string &xor_result);
+        // Block mode: decodes the block at pos, advancing pos past it. The lines are in input order
+        // and stay valid until the next block.
+        const std::vector<std::string> &decompress_block(const Bit_View &input_data, size_t &pos, std::string &xor_result);
     };
 
 }
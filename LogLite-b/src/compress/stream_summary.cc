@@ -0,0 +1,340 @@
+#include "stream_summary.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "common/bit_coding.h"
+#include "common/bitmask.h"
+#include "common/numeric_delta.h"
+#include "compress/compress_stats.h"
+
+namespace XORC
+{
+
+    void Summary_Counts::write_json(std::ostream &os) const
+    {
+        os << "{\"lines\": " << lines
+           << ", \"bytes\": " << bytes
+           << ", \"new_families\": " << new_families
+           << ", \"unstored_lines\": " << unstored_lines
+           << ", \"xor_lines\": " << xor_lines
+           << ", \"changed_bytes\": " << changed_bytes
+           << ", \"numeric_fields\": " << numeric_fields << "}";
+    }
+
+    size_t Stream_Summary::read_stream_header(const Bit_View &input_data)
+    {
+        return this->codec.read_stream_header(input_data);
+    }
+
+    void Stream_Summary::begin_interval(int64_t min_time, int64_t max_time)
+    {
+        Summary_Interval interval;
+        interval.first_line = this->line_count;
+        interval.min_time = min_time;
+        interval.max_time = max_time;
+        this->intervals.push_back(interval);
+    }
+
+    // Mirrors Stream_Compress::push_window and update_window_usage, keeping families for lines.
+    void Stream_Summary::push_window(size_t key, uint32_t family)
+    {
+        std::deque<uint32_t> &bucket = this->window[key];
+        const size_t len_bucket_before = bucket.size();
+        if (len_bucket_before == EACH_WINDOW_SIZE)
+        {
+            bucket.pop_front();
+        }
+        bucket.push_back(family);
+        this->window_bytes += this->codec.window_charge(key, bucket.size()) - this->codec.window_charge(key, len_bucket_before);
+
+        const size_t window_budget = this->codec.options.window_budget;
+        if (window_budget == 0)
+        {
+            return;
+        }
+
+        auto position = this->window_lru_position.find(key);
+        if (position == this->window_lru_position.end())
+        {
+            this->window_lru_position[key] = this->window_lru.insert(this->window_lru.end(), key);
+        }
+        else
+        {
+            this->window_lru.splice(this->window_lru.end(), this->window_lru, position->second);
+        }
+
+        while (this->window_bytes > window_budget && this->window_lru.size() > 1)
+        {
+            size_t evicted = this->window_lru.front();
+            this->window_lru.pop_front();
+            this->window_lru_position.erase(evicted);
+
+            auto evicted_bucket = this->window.find(evicted);
+            this->window_bytes -= this->codec.window_charge(evicted, evicted_bucket->second.size());
+            this->window.erase(evicted_bucket);
+        }
+    }
+
+    // Returns the family of the record at pos (NO_FAMILY when the window does not keep the line)
+    // and advances pos past it; key is 0 for whole lines and the chunk key for long line chunks.
+    uint32_t Stream_Summary::walk_record(const Bit_View &input_data, size_t &pos, size_t key, size_t &len_line, size_t &changed_bytes)
+    {
+        if (pos >= input_data.size())
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        if (input_data[pos++] == 0)
+        {
+            if (input_data.size() - pos < ORIGINAL_LENGTH_COUNT)
+            {
+                throw std::runtime_error("Malformed compressed record.");
+            }
+            size_t original_length = input_data.bits(pos, ORIGINAL_LENGTH_COUNT);
+            pos += ORIGINAL_LENGTH_COUNT;
+
+            if (key == 0 && original_length >= MAX_LEN && this->codec.options.long_line_chunks)
+            {
+                original_length = this->codec.read_long_line_length(input_data, pos, original_length);
+                // the family of a long line is the one of its first chunk
+                uint32_t family = NO_FAMILY;
+                const size_t chunk_count = (original_length + LONG_LINE_CHUNK_SIZE - 1) / LONG_LINE_CHUNK_SIZE;
+                for (size_t k = 0; k < chunk_count; ++k)
+                {
+                    size_t len_chunk, chunk_changed_bytes = 0;
+                    uint32_t chunk_family = walk_record(input_data, pos, longLineChunkKey(k), len_chunk, chunk_changed_bytes);
+                    family = k == 0 ? chunk_family : family;
+                    changed_bytes += chunk_changed_bytes;
+                }
+                len_line = original_length;
+                return family;
+            }
+
+            if (input_data.size() - pos < original_length * 8)
+            {
+                throw std::runtime_error("Malformed compressed record.");
+            }
+            pos += original_length * 8;
+            len_line = key ? LONG_LINE_CHUNK_SIZE : original_length;
+            if (!key && (original_length == 0 || original_length >= MAX_LEN))
+            {
+                return NO_FAMILY;
+            }
+            this->families.emplace_back();
+            push_window(key ? key : original_length, this->families.size() - 1);
+            return this->families.size() - 1;
+        }
+
+        if (input_data.size() - pos < EACH_WINDOW_SIZE_COUNT + STREAM_ENCODER_COUNT)
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        size_t window_id = input_data.bits(pos, EACH_WINDOW_SIZE_COUNT);
+        pos += EACH_WINDOW_SIZE_COUNT;
+        size_t len_single_data = input_data.bits(pos, STREAM_ENCODER_COUNT);
+        pos += STREAM_ENCODER_COUNT;
+        if (input_data.size() - pos < len_single_data)
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        const Bit_View single_data = input_data.subview(pos, len_single_data);
+        pos += len_single_data;
+
+        // the segment references only matter to the bytes; the family is the base reference's
+        size_t i = 0;
+        if (this->codec.options.segment_refs)
+        {
+            size_t switch_count = readEliasGamma(single_data, i) - 1;
+            for (size_t k = 0; k < switch_count; ++k)
+            {
+                readEliasGamma(single_data, i);
+                i += EACH_WINDOW_SIZE_COUNT;
+            }
+        }
+        if (this->codec.options.numeric_delta)
+        {
+            numericDeltaRead(single_data, i, this->numeric_deltas);
+            this->line_numeric_fields += this->numeric_deltas.size();
+        }
+
+        len_line = 0;
+        if (this->codec.options.cost_model && len_single_data - i >= 1 + RLE_COUNT && single_data.bits(i, 1 + RLE_COUNT) == 0)
+        {
+            i += 1 + RLE_COUNT;
+            size_t changed_count;
+            len_line = bitmaskLineLength(single_data, i, changed_count);
+            changed_bytes += changed_count;
+        }
+        else
+        {
+            while (i < len_single_data)
+            {
+                if (single_data[i])
+                {
+                    i += 1 + RLE_SKIM;
+                    ++len_line;
+                    ++changed_bytes;
+                }
+                else
+                {
+                    len_line += single_data.bits(i + 1, RLE_COUNT);
+                    i += 1 + RLE_COUNT;
+                }
+            }
+        }
+
+        key = key ? key : len_line;
+        auto bucket = this->window.find(key);
+        if (bucket == this->window.end() || window_id >= bucket->second.size())
+        {
+            throw std::runtime_error("Malformed compressed record.");
+        }
+        uint32_t family = bucket->second[window_id];
+        push_window(key, family);
+        return family;
+    }
+
+    void Stream_Summary::walk_line(const Bit_View &input_data, size_t &pos)
+    {
+        this->line_numeric_fields = 0;
+        size_t len_line = 0, changed_bytes = 0;
+        uint32_t family = walk_record(input_data, pos, 0, len_line, changed_bytes);
+
+        Summary_Counts line;
+        line.lines = 1;
+        line.bytes = len_line;
+        line.numeric_fields = this->line_numeric_fields;
+        if (family == NO_FAMILY)
+        {
+            line.unstored_lines = 1;
+        }
+        else if (this->families[family].lines == 0)
+        {
+            line.new_families = 1;
+            this->families[family].length = len_line;
+            this->families[family].first_line = this->line_count;
+        }
+        else
+        {
+            line.xor_lines = 1;
+            line.changed_bytes = changed_bytes;
+            ++this->changed_histogram[Compress_Stats::bucket_of(changed_bytes)];
+        }
+        if (family != NO_FAMILY)
+        {
+            ++this->families[family].lines;
+            this->families[family].changed_bytes += line.changed_bytes;
+        }
+
+        if (this->intervals.empty())
+        {
+            begin_interval();
+        }
+        for (Summary_Counts *counts : {&this->total, &this->length_buckets[Compress_Stats::bucket_of(len_line)], &this->intervals.back().counts})
+        {
+            counts->lines += line.lines;
+            counts->bytes += line.bytes;
+            counts->new_families += line.new_families;
+            counts->unstored_lines += line.unstored_lines;
+            counts->xor_lines += line.xor_lines;
+            counts->changed_bytes += line.changed_bytes;
+            counts->numeric_fields += line.numeric_fields;
+        }
+        ++this->line_count;
+    }
+
+    void Stream_Summary::summarize_next(const Bit_View &input_data, size_t &pos)
+    {
+        if (!this->codec.options.reorder_block)
+        {
+            walk_line(input_data, pos);
+            return;
+        }
+
+        // the lines of a block are walked in stored order; only their count matters here
+        this->codec.read_block_order(input_data, pos);
+        for (size_t k = 0; k < this->codec.block_order.size(); ++k)
+        {
+            walk_line(input_data, pos);
+        }
+    }
+
+    void Stream_Summary::write_json(std::ostream &os) const
+    {
+        std::vector<uint32_t> top;
+        uint64_t family_count = 0, single_line_families = 0;
+        for (uint32_t i = 0; i < this->families.size(); ++i)
+        {
+            // chunks after the first of a long line start families of no line
+            if (this->families[i].lines == 0)
+            {
+                continue;
+            }
+            ++family_count;
+            single_line_families += this->families[i].lines == 1;
+            top.push_back(i);
+        }
+        const size_t top_count = std::min<size_t>(top.size(), SUMMARY_TOP_FAMILIES);
+        std::partial_sort(top.begin(), top.begin() + top_count, top.end(), [&](uint32_t a, uint32_t b)
+                          { return this->families[a].lines > this->families[b].lines; });
+
+        os << "{\n  \"total\": ";
+        this->total.write_json(os);
+        os << ",\n  \"families\": {\"count\": " << family_count << ", \"single_line\": " << single_line_families << ", \"top\": [";
+        for (size_t k = 0; k < top_count; ++k)
+        {
+            const Template_Family &family = this->families[top[k]];
+            os << (k ? ",\n" : "\n") << "    {\"family\": " << top[k]
+               << ", \"length\": " << family.length
+               << ", \"first_line\": " << family.first_line
+               << ", \"lines\": " << family.lines
+               << ", \"mean_changed_bytes\": " << static_cast<double>(family.changed_bytes) / std::max<uint64_t>(1, family.lines - 1) << "}";
+        }
+        os << (top_count ? "\n  ]}" : "]}");
+
+        os << ",\n  \"changed_bytes_histogram\": [";
+        bool first = true;
+        for (size_t i = 0; i < STATS_LENGTH_BUCKET_COUNT; ++i)
+        {
+            if (this->changed_histogram[i] == 0)
+            {
+                continue;
+            }
+            os << (first ? "\n" : ",\n") << "    {\"min_changed\": " << (i == 0 ? 0 : static_cast<size_t>(1) << (i - 1))
+               << ", \"xor_lines\": " << this->changed_histogram[i] << "}";
+            first = false;
+        }
+        os << (first ? "]" : "\n  ]");
+
+        os << ",\n  \"length_buckets\": [";
+        first = true;
+        for (size_t i = 0; i < STATS_LENGTH_BUCKET_COUNT; ++i)
+        {
+            if (this->length_buckets[i].lines == 0)
+            {
+                continue;
+            }
+            os << (first ? "\n" : ",\n") << "    {\"min_length\": " << (i == 0 ? 0 : static_cast<size_t>(1) << (i - 1)) << ", \"counts\": ";
+            this->length_buckets[i].write_json(os);
+            os << "}";
+            first = false;
+        }
+        os << (first ? "]" : "\n  ]");
+
+        os << ",\n  \"intervals\": [";
+        for (size_t k = 0; k < this->intervals.size(); ++k)
+        {
+            const Summary_Interval &interval = this->intervals[k];
+            os << (k ? ",\n" : "\n") << "    {\"first_line\": " << interval.first_line;
+            if (interval.min_time <= interval.max_time)
+            {
+                os << ", \"min_time\": " << interval.min_time << ", \"max_time\": " << interval.max_time;
+            }
+            os << ", \"counts\": ";
+            interval.counts.write_json(os);
+            os << "}";
+        }
+        os << (this->intervals.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    }
+
+}
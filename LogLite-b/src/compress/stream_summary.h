@@ -0,0 +1,94 @@
+#ifndef XORC_STREAM_COMPRESS_SUMMARY_H_
+#define XORC_STREAM_COMPRESS_SUMMARY_H_
+
+#include <ostream>
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <limits>
+#include <cstdint>
+
+#include "common/bit_view.h"
+#include "common/constants.h"
+#include "compress/stream_compress.h"
+
+namespace XORC
+{
+
+    struct Summary_Counts
+    {
+        uint64_t lines = 0;
+        uint64_t bytes = 0;
+        uint64_t new_families = 0;
+        uint64_t unstored_lines = 0; // empty, or too long for the window
+        uint64_t xor_lines = 0;
+        uint64_t changed_bytes = 0; // bytes of XOR lines that differ from their reference
+        uint64_t numeric_fields = 0;
+
+        void write_json(std::ostream &os) const;
+    };
+
+    // A reference chain: a raw record and every XOR record that refers back to it, directly or
+    // through other lines of the chain. Lines of one family share a length and mostly a template.
+    struct Template_Family
+    {
+        uint64_t length = 0;
+        uint64_t first_line = 0;
+        uint64_t lines = 0;
+        uint64_t changed_bytes = 0;
+    };
+
+    struct Summary_Interval
+    {
+        uint64_t first_line = 0;
+        int64_t min_time = std::numeric_limits<int64_t>::max();
+        int64_t max_time = std::numeric_limits<int64_t>::min();
+        Summary_Counts counts;
+    };
+
+    // Compressed-domain statistics: walks record headers, RLE tokens and bitmask counts without
+    // rebuilding any line. The window is mirrored with the family of each line it would hold in
+    // place of the bytes, evicted exactly as the decoder would, so window ids resolve to families.
+    class Stream_Summary
+    {
+    private:
+        static constexpr uint32_t NO_FAMILY = std::numeric_limits<uint32_t>::max();
+
+        Stream_Compress codec; // adopts the stream options and reads block orders
+        std::unordered_map<size_t, std::deque<uint32_t>> window;
+        size_t window_bytes = 0;
+        std::list<size_t> window_lru;
+        std::unordered_map<size_t, std::list<size_t>::iterator> window_lru_position;
+        std::vector<std::pair<uint32_t, int64_t>> numeric_deltas;
+        uint64_t line_numeric_fields = 0;
+
+        std::vector<Template_Family> families;
+        Summary_Counts total;
+        Summary_Counts length_buckets[STATS_LENGTH_BUCKET_COUNT];
+        // XOR lines by bit width of their changed byte count, as length_buckets
+        uint64_t changed_histogram[STATS_LENGTH_BUCKET_COUNT] = {};
+        std::vector<Summary_Interval> intervals;
+        uint64_t line_count = 0;
+
+        void push_window(size_t key, uint32_t family);
+        uint32_t walk_record(const Bit_View &input_data, size_t &pos, size_t key, size_t &len_line, size_t &changed_bytes);
+        void walk_line(const Bit_View &input_data, size_t &pos);
+
+    public:
+        // Returns the number of header bits, as Stream_Compress::read_stream_header.
+        size_t read_stream_header(const Bit_View &input_data);
+
+        // Lines walked from here on are counted in a new interval of the time series.
+        void begin_interval(int64_t min_time = std::numeric_limits<int64_t>::max(), int64_t max_time = std::numeric_limits<int64_t>::min());
+        uint64_t interval_lines() const { return intervals.empty() ? 0 : intervals.back().counts.lines; }
+
+        // Walks the record (or in block mode the block) at pos, advancing pos past it.
+        void summarize_next(const Bit_View &input_data, size_t &pos);
+
+        void write_json(std::ostream &os) const;
+    };
+
+}
+
+#endif
@@ -9,15 +9,72 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <filesystem>
+#include <thread>
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <signal.h>
+#include <functional>
+#include <mutex>
+#include <atomic>
 
 #include "common/file.h"
+#include "common/file_follower.h"
+#include "common/line_index.h"
+#include "common/output_sink.h"
+#include "common/trace.h"
+#include "common/perf_counters.h"
+#include "common/huge_pages.h"
+#include "common/checksum.h"
+#include "common/timestamp.h"
+#include "common/bloom_filter.h"
 #include "compress/stream_compress.h"
+#include "compress/compressor_group.h"
+#include "compress/archive_index.h"
+#include "compress/stream_summary.h"
+#include "compress/ingest_compressor.h"
+#include "compress/sample_estimator.h"
+#include "compress/line_cursor.h"
 
 static struct config
 {
     bool stream_compress;
     bool stream_decompress;
     bool is_test;
+    bool numeric_delta;
+    size_t window_budget;
+    bool cost_model;
+    bool segment_refs;
+    bool long_line_chunks;
+    size_t reorder_block;
+    const char *timestamp_format;
+    size_t checkpoint_lines;
+    bool trigram_filters;
+    double false_positive_rate;
+    const char *since;
+    const char *until;
+    const char *grep;
+    bool summarize;
+    bool ingest_bench;
+    XORC::Overflow_Policy overflow;
+    size_t ingest_capacity;
+    bool direct_io;
+    bool append;
+    bool stats;
+    bool timing;
+    bool perf_counters;
+    bool huge_pages;
+    bool huge_page_bench;
+    bool checksums;
+    bool verify;
+    bool estimate;
+    double sample_fraction;
+    const char *trace_path;
+    unsigned thread_count;
+    const char *follow_path;
+    const char *inputs_path;
+    int flush_interval_ms;
+    uint64_t flush_bytes;
 
     const char *file_path;
     const char *output_path;
@@ -29,6 +86,40 @@ static void parseOptions(int argc, const char **argv)
     config.stream_compress = false;
     config.stream_decompress = false;
     config.is_test = false;
+    config.numeric_delta = false;
+    config.window_budget = 0;
+    config.cost_model = false;
+    config.segment_refs = false;
+    config.long_line_chunks = false;
+    config.reorder_block = 0;
+    config.timestamp_format = nullptr;
+    config.checkpoint_lines = ARCHIVE_INDEX_CHECKPOINT_LINES;
+    config.trigram_filters = false;
+    config.false_positive_rate = TRIGRAM_FILTER_FALSE_POSITIVE_RATE;
+    config.since = nullptr;
+    config.until = nullptr;
+    config.grep = nullptr;
+    config.summarize = false;
+    config.ingest_bench = false;
+    config.overflow = XORC::Overflow_Policy::BLOCK;
+    config.ingest_capacity = INGEST_QUEUE_CAPACITY;
+    config.direct_io = false;
+    config.append = false;
+    config.stats = false;
+    config.timing = false;
+    config.perf_counters = false;
+    config.huge_pages = false;
+    config.huge_page_bench = false;
+    config.checksums = false;
+    config.verify = false;
+    config.estimate = false;
+    config.sample_fraction = ESTIMATE_SAMPLE_FRACTION;
+    config.trace_path = nullptr;
+    config.thread_count = std::max(1u, std::thread::hardware_concurrency());
+    config.follow_path = nullptr;
+    config.inputs_path = nullptr;
+    config.flush_interval_ms = 1000;
+    config.flush_bytes = 1 << 20;
 
     for (int i = 1; i < argc; i++)
     {
@@ -45,6 +136,165 @@ static void parseOptions(int argc, const char **argv)
         {
             config.is_test = true;
         }
+        else if (!strcmp(argv[i], "--numeric-delta") && !lastarg)
+        {
+            config.numeric_delta = true;
+        }
+        else if (!strcmp(argv[i], "--cost-model") && !lastarg)
+        {
+            config.cost_model = true;
+        }
+        else if (!strcmp(argv[i], "--segment-refs") && !lastarg)
+        {
+            config.segment_refs = true;
+        }
+        else if (!strcmp(argv[i], "--chunk-long-lines") && !lastarg)
+        {
+            config.long_line_chunks = true;
+        }
+        else if (!strcmp(argv[i], "--reorder-block") && !lastarg)
+        {
+            config.reorder_block = std::max(0LL, atoll(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--timestamp-format") && !lastarg)
+        {
+            config.timestamp_format = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--checkpoint-lines") && !lastarg)
+        {
+            config.checkpoint_lines = std::max(1LL, atoll(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--bloom") && !lastarg)
+        {
+            config.trigram_filters = true;
+        }
+        else if (!strcmp(argv[i], "--bloom-fpr") && !lastarg)
+        {
+            config.trigram_filters = true;
+            config.false_positive_rate = std::clamp(atof(argv[++i]), 1e-6, 0.5);
+        }
+        else if (!strcmp(argv[i], "--grep") && !lastarg)
+        {
+            config.grep = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--summarize") && !lastarg)
+        {
+            config.summarize = true;
+        }
+        else if (!strcmp(argv[i], "--ingest-bench") && !lastarg)
+        {
+            config.ingest_bench = true;
+        }
+        else if (!strcmp(argv[i], "--overflow") && !lastarg)
+        {
+            const char *policy = argv[++i];
+            if (!strcmp(policy, "block"))
+            {
+                config.overflow = XORC::Overflow_Policy::BLOCK;
+            }
+            else if (!strcmp(policy, "drop"))
+            {
+                config.overflow = XORC::Overflow_Policy::DROP;
+            }
+            else if (!strcmp(policy, "spill"))
+            {
+                config.overflow = XORC::Overflow_Policy::SPILL;
+            }
+            else
+            {
+                std::cerr << "--overflow must be block, drop or spill" << std::endl;
+                exit(1);
+            }
+        }
+        else if (!strcmp(argv[i], "--ingest-capacity") && !lastarg)
+        {
+            config.ingest_capacity = std::max(1LL, atoll(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--since") && !lastarg)
+        {
+            config.since = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--until") && !lastarg)
+        {
+            config.until = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--window-budget") && !lastarg)
+        {
+            config.window_budget = std::max(0LL, atoll(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--append") && !lastarg)
+        {
+            config.append = true;
+        }
+        else if (!strcmp(argv[i], "--direct-io") && !lastarg)
+        {
+            config.direct_io = true;
+        }
+        else if (!strcmp(argv[i], "--stats") && !lastarg)
+        {
+#ifdef XORC_STATS
+            config.stats = true;
+#else
+            std::cerr << "--stats needs a build with -DXORC_STATS" << std::endl;
+            exit(1);
+#endif
+        }
+        else if (!strcmp(argv[i], "--timing") && !lastarg)
+        {
+            config.timing = true;
+        }
+        else if (!strcmp(argv[i], "--perf-counters") && !lastarg)
+        {
+            config.perf_counters = true;
+        }
+        else if (!strcmp(argv[i], "--huge-pages") && !lastarg)
+        {
+            config.huge_pages = true;
+        }
+        else if (!strcmp(argv[i], "--huge-page-bench") && !lastarg)
+        {
+            config.huge_page_bench = true;
+        }
+        else if (!strcmp(argv[i], "--checksums") && !lastarg)
+        {
+            config.checksums = true;
+        }
+        else if (!strcmp(argv[i], "--verify") && !lastarg)
+        {
+            config.verify = true;
+        }
+        else if (!strcmp(argv[i], "--estimate") && !lastarg)
+        {
+            config.estimate = true;
+        }
+        else if (!strcmp(argv[i], "--sample-fraction") && !lastarg)
+        {
+            config.sample_fraction = std::min(1.0, std::max(0.0, atof(argv[++i])));
+        }
+        else if (!strcmp(argv[i], "--trace") && !lastarg)
+        {
+            config.trace_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--threads") && !lastarg)
+        {
+            config.thread_count = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--follow") && !lastarg)
+        {
+            config.follow_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--inputs") && !lastarg)
+        {
+            config.inputs_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--flush-interval") && !lastarg)
+        {
+            config.flush_interval_ms = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--flush-bytes") && !lastarg)
+        {
+            config.flush_bytes = std::max(1LL, atoll(argv[++i]));
+        }
         else if (!strcmp(argv[i], "--file-path") && !lastarg)
         {
             config.file_path = const_cast<char *>(argv[++i]);
@@ -59,6 +309,45 @@ static void parseOptions(int argc, const char **argv)
             exit(1);
         }
     }
+
+    // --inputs writes one archive per file of its directory, it is not a modifier of other modes
+    if (config.inputs_path != nullptr && (config.stream_compress || config.stream_decompress || config.is_test))
+    {
+        std::cerr << "--inputs cannot be combined with --compress, --decompress or --test" << std::endl;
+        exit(1);
+    }
+    // --follow, --ingest-bench and --estimate compress line by line
+    if (config.reorder_block > 0 && (config.follow_path != nullptr || config.ingest_bench || config.estimate))
+    {
+        std::cerr << "--reorder-block only works with --compress and --inputs" << std::endl;
+        exit(1);
+    }
+    // only --compress writes the archive index that --since/--until/--grep read
+    const bool is_indexed = config.timestamp_format != nullptr || config.trigram_filters;
+    if (is_indexed && (config.follow_path != nullptr || config.inputs_path != nullptr || config.ingest_bench))
+    {
+        std::cerr << "--timestamp-format and --bloom only work with --compress, the other modes write no archive index" << std::endl;
+        exit(1);
+    }
+    // framed archives end in no trailer
+    if (config.checksums && (config.follow_path != nullptr || config.ingest_bench))
+    {
+        std::cerr << "--checksums only works with --compress and --inputs" << std::endl;
+        exit(1);
+    }
+}
+
+// The codec options of the command line, for every mode that compresses.
+static XORC::Stream_Options streamOptionsFromConfig()
+{
+    XORC::Stream_Options options;
+    options.numeric_delta = config.numeric_delta;
+    options.window_budget = config.window_budget;
+    options.cost_model = config.cost_model;
+    options.segment_refs = config.segment_refs;
+    options.long_line_chunks = config.long_line_chunks;
+    options.reorder_block = config.reorder_block;
+    return options;
 }
 
 std::streampos file_size(const char *filename)
@@ -95,10 +384,697 @@ bool areFilesEqual(const std::string &filePath1, const std::string &filePath2)
     return std::equal(begin1, end, begin2);
 }
 
+// --append keeps <archive>.window: the archive's length in bits, then Stream_Compress::save_window.
+static std::string windowSnapshotPath()
+{
+    return std::string(config.output_path) + ".window";
+}
+
+static void saveWindowSnapshot(const XORC::Stream_Compress &sc, uint64_t archive_bits)
+{
+    std::string snapshot;
+    sc.save_window(snapshot);
+    snapshot.insert(0, reinterpret_cast<const char *>(&archive_bits), sizeof(archive_bits));
+    XORC::write_string_to_file(snapshot, windowSnapshotPath().c_str());
+}
+
+// Prepares config.output_path for --append: adopts the archive's options and window, moves its
+// unfinished last block into output_data and cuts that block and the trailer off the file.
+// The window comes from the snapshot if it matches the archive, otherwise from decoding it.
+// Returns false when there is no archive to continue.
+static bool resumeArchive(XORC::Stream_Compress &sc, XORC::Output_Bitset &output_data, uint64_t &len_output_data, uint64_t &len_drained_data)
+{
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(config.output_path, error) || std::filesystem::file_size(config.output_path, error) == 0)
+    {
+        return false;
+    }
+
+    size_t len_kept_blocks;
+    {
+        XORC::Mapped_File archive(config.output_path);
+        if (XORC::is_framed_archive(archive.data(), archive.size()))
+        {
+            throw std::runtime_error("Cannot append to a framed archive.");
+        }
+        XORC::Bit_View archive_bitset = XORC::view_bitset_in_file(archive);
+        if (archive_bitset.empty())
+        {
+            return false;
+        }
+
+        size_t len_stream_header = sc.read_stream_header(archive_bitset);
+
+        std::string snapshot;
+        uint64_t snapshot_bits = 0;
+        if (std::filesystem::is_regular_file(windowSnapshotPath(), error))
+        {
+            XORC::read_string_from_file(snapshot, windowSnapshotPath().c_str());
+            if (snapshot.size() >= sizeof(snapshot_bits))
+            {
+                memcpy(&snapshot_bits, snapshot.data(), sizeof(snapshot_bits));
+            }
+        }
+
+        if (snapshot_bits == archive_bitset.size())
+        {
+            sc.load_window(std::string_view(snapshot).substr(sizeof(snapshot_bits)));
+            std::cout << "Resuming archive with window snapshot " << windowSnapshotPath() << std::endl;
+        }
+        else
+        {
+            XORC::Line_Cursor cursor(sc, archive_bitset, len_stream_header);
+            while (cursor.has_next())
+            {
+                cursor.next();
+            }
+            std::cout << "Resuming archive, window rebuilt by decoding it" << std::endl;
+        }
+
+        len_kept_blocks = archive_bitset.size() / 64;
+        len_output_data = archive_bitset.size() % 64;
+        for (size_t i = 0; i < len_output_data; ++i)
+        {
+            output_data[i] = archive_bitset[len_kept_blocks * 64 + i];
+        }
+        len_drained_data = len_kept_blocks * 64;
+    }
+
+    std::filesystem::resize_file(config.output_path, len_kept_blocks * sizeof(unsigned long));
+    return true;
+}
+
+static volatile sig_atomic_t follow_stopping = 0;
+
+static void stopFollowing(int)
+{
+    follow_stopping = 1;
+}
+
+// Compresses lines as they are appended to config.follow_path until SIGINT/SIGTERM. The output is
+// a framed archive: a frame is written every flush_bytes of input or flush_interval_ms, whichever
+// comes first, so the archive decodes up to the last frame at any time.
+static void followFile()
+{
+    struct sigaction action = {};
+    action.sa_handler = stopFollowing;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    XORC::File_Follower follower(config.follow_path);
+    XORC::Output_Sink sink(config.output_path);
+
+    XORC::Output_Bitset output_data(2 * OUTPUT_CHUNK_SIZE * 8);
+    uint64_t len_output_data = 0;
+
+    XORC::Stream_Compress sc(streamOptionsFromConfig());
+    sc.write_stream_header(output_data, len_output_data);
+
+    uint64_t len_raw_data = 0;
+    uint64_t len_frame_data = 0;
+    size_t line_count = 0;
+    size_t frame_count = 0;
+
+    auto compress_line = [&](std::string_view line)
+    {
+        size_t max_record_bits = XORC::Stream_Compress::max_record_bits(line.size());
+        if (len_output_data + max_record_bits > output_data.size())
+        {
+            output_data.resize(len_output_data + max_record_bits);
+        }
+        sc.stream_compress(line, output_data, len_output_data);
+        len_frame_data += line.size() + 1;
+        ++line_count;
+    };
+
+    auto write_frame = [&]()
+    {
+        len_raw_data += len_frame_data;
+        len_frame_data = 0;
+        sink.write_frame(output_data, len_output_data);
+        ++frame_count;
+    };
+
+    const uint64_t flush_interval = static_cast<uint64_t>(config.flush_interval_ms) * 1000000;
+    uint64_t last_flush = XORC::traceWallNanos();
+    std::vector<std::string_view> lines;
+    while (!follow_stopping)
+    {
+        uint64_t elapsed = XORC::traceWallNanos() - last_flush;
+        int timeout_ms = elapsed >= flush_interval ? 0 : (flush_interval - elapsed + 999999) / 1000000;
+        follower.poll_lines(len_frame_data > 0 ? timeout_ms : config.flush_interval_ms, lines);
+
+        for (std::string_view line : lines)
+        {
+            compress_line(line);
+        }
+
+        uint64_t now = XORC::traceWallNanos();
+        if (len_frame_data >= config.flush_bytes || (len_frame_data > 0 && now - last_flush >= flush_interval))
+        {
+            write_frame();
+            last_flush = now;
+        }
+        else if (len_frame_data == 0)
+        {
+            last_flush = now;
+        }
+    }
+
+    if (!follower.partial_line().empty())
+    {
+        compress_line(follower.partial_line());
+    }
+    if (len_output_data > 0)
+    {
+        write_frame();
+    }
+
+    std::cout << "Followed " << line_count << " lines (" << len_raw_data << " bytes) into "
+              << frame_count << " frames" << std::endl;
+}
+
+// Compresses every regular file in config.inputs_path into config.output_path/<name>.xc, each with
+// its own window, in parallel on config.thread_count workers.
+static void compressDirectory()
+{
+    std::vector<std::filesystem::path> inputs;
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(config.inputs_path))
+    {
+        if (entry.is_regular_file())
+        {
+            inputs.push_back(entry.path());
+        }
+    }
+    std::sort(inputs.begin(), inputs.end());
+    std::filesystem::create_directories(config.output_path);
+
+    uint64_t wall_begin = XORC::traceWallNanos();
+
+    XORC::Compressor_Group group(config.thread_count, streamOptionsFromConfig());
+
+    std::vector<std::unique_ptr<XORC::Mapped_File>> mapped_inputs;
+    for (const std::filesystem::path &input : inputs)
+    {
+        mapped_inputs.emplace_back(new XORC::Mapped_File(input.c_str()));
+        const XORC::Mapped_File &all_data = *mapped_inputs.back();
+
+        std::filesystem::path output = std::filesystem::path(config.output_path) / input.filename();
+        size_t source_id = group.add_source(output.string() + ".xc", config.checksums, config.direct_io);
+
+        size_t begin = 0;
+        while (begin < all_data.size())
+        {
+            size_t end = std::min(begin + GROUP_BATCH_SIZE, all_data.size());
+            const char *newline = static_cast<const char *>(memchr(all_data.data() + end - 1, '\n', all_data.size() - end + 1));
+            end = newline == nullptr ? all_data.size() : newline - all_data.data() + 1;
+
+            group.submit(source_id, std::string_view(all_data.data() + begin, end - begin));
+            begin = end;
+        }
+    }
+    group.finish();
+
+    double wall_seconds = (XORC::traceWallNanos() - wall_begin) / 1e9;
+
+    uint64_t raw_size = 0;
+    uint64_t compressed_size = 0;
+    for (size_t i = 0; i < group.size(); ++i)
+    {
+        std::cout << inputs[i].filename().string() << ": " << group.line_count(i) << " lines, rate "
+                  << static_cast<double>(group.compressed_bytes(i)) / std::max<uint64_t>(1, group.raw_bytes(i)) << std::endl;
+        raw_size += group.raw_bytes(i);
+        compressed_size += group.compressed_bytes(i);
+    }
+
+    std::cout << "Compression rate (with separator): "
+              << static_cast<double>(compressed_size) / std::max<uint64_t>(1, raw_size)
+              << std::endl;
+    std::cout << "Compression speed: "
+              << (double)(raw_size) / (1024 * 1024) / wall_seconds
+              << " MB/s (wall " << wall_seconds << " s, " << inputs.size() << " files, "
+              << config.thread_count << " threads)" << std::endl;
+}
+
+// --decompress with --since/--until and/or --grep: decodes only the intervals of the archive index
+// whose time span overlaps the range and whose trigram filter may hold the literal, each run of them
+// starting from its checkpointed window, and keeps the lines in range that contain the literal.
+static void extractFromIndex()
+{
+    uint64_t wall_begin = XORC::traceWallNanos();
+
+    XORC::Archive_Index_Header index_header;
+    std::vector<XORC::Archive_Checkpoint> checkpoints;
+    XORC::read_archive_index(std::string(config.file_path) + ".index", index_header, checkpoints);
+
+    const bool is_time_range = config.since != nullptr || config.until != nullptr;
+    if (is_time_range && !index_header.has_time())
+    {
+        throw std::runtime_error("--since/--until need an archive compressed with --timestamp-format.");
+    }
+    std::unique_ptr<XORC::Timestamp_Format> timestamp_format;
+    int64_t since = std::numeric_limits<int64_t>::min();
+    int64_t until = std::numeric_limits<int64_t>::max();
+    if (index_header.has_time())
+    {
+        timestamp_format.reset(new XORC::Timestamp_Format(index_header.timestamp_format));
+        if ((config.since != nullptr && !timestamp_format->parse(config.since, since)) ||
+            (config.until != nullptr && !timestamp_format->parse(config.until, until)))
+        {
+            throw std::runtime_error("--since/--until must match the archive's timestamp format " + index_header.timestamp_format);
+        }
+    }
+    const std::string_view literal = config.grep != nullptr ? config.grep : "";
+    auto is_candidate = [&](const XORC::Archive_Checkpoint &checkpoint)
+    {
+        return (!is_time_range || checkpoint.overlaps(since, until)) &&
+               XORC::trigramFilterMayContain(checkpoint.trigram_filter, literal);
+    };
+
+    XORC::Mapped_File compressed_file(config.file_path);
+    if (XORC::is_framed_archive(compressed_file.data(), compressed_file.size()))
+    {
+        throw std::runtime_error("Indexed extraction needs an archive written by --compress.");
+    }
+    XORC::Bit_View compressed_bitset = XORC::view_bitset_in_file(compressed_file);
+
+    XORC::Stream_Compress sc;
+    sc.read_stream_header(compressed_bitset);
+
+    XORC::Output_Sink sink(config.output_path);
+    std::string all_data;
+    uint64_t len_raw_data = 0;
+    size_t line_count = 0;
+    size_t decoded_line_count = 0;
+    size_t decoded_checkpoint_count = 0;
+
+    int64_t current_time = 0;
+    auto keep_line = [&](std::string_view line)
+    {
+        int64_t line_time;
+        if (timestamp_format && timestamp_format->parse(line, line_time))
+        {
+            current_time = line_time;
+        }
+        if ((!is_time_range || (current_time >= since && current_time <= until)) &&
+            line.find(literal) != std::string_view::npos)
+        {
+            all_data += line;
+            all_data += "\n";
+            ++line_count;
+        }
+        ++decoded_line_count;
+    };
+
+    size_t k = 0;
+    while (k < checkpoints.size())
+    {
+        if (!is_candidate(checkpoints[k]))
+        {
+            ++k;
+            continue;
+        }
+        size_t run_end = k + 1;
+        while (run_end < checkpoints.size() && is_candidate(checkpoints[run_end]))
+        {
+            ++run_end;
+        }
+        size_t len_run_end = run_end < checkpoints.size() ? checkpoints[run_end].bit_offset : compressed_bitset.size();
+        decoded_checkpoint_count += run_end - k;
+
+        sc.load_window(checkpoints[k].window);
+        current_time = checkpoints[k].initial_time;
+        XORC::Line_Cursor cursor(sc, compressed_bitset.subview(0, len_run_end), checkpoints[k].bit_offset);
+        while (cursor.has_next())
+        {
+            keep_line(cursor.next());
+
+            if (all_data.size() >= OUTPUT_CHUNK_SIZE)
+            {
+                len_raw_data += all_data.size();
+                sink.write(all_data.data(), all_data.size());
+                all_data.clear();
+            }
+        }
+        k = run_end;
+    }
+
+    len_raw_data += all_data.size();
+    sink.write(all_data.data(), all_data.size());
+    sink.flush();
+
+    double wall_seconds = (XORC::traceWallNanos() - wall_begin) / 1e9;
+    std::cout << "Extracted " << line_count << " lines (" << len_raw_data << " bytes) from " << decoded_line_count
+              << " decoded lines in " << decoded_checkpoint_count << " of " << checkpoints.size() << " intervals, wall "
+              << wall_seconds << " s" << std::endl;
+}
+
+// --summarize: compressed-domain statistics of an archive, without rebuilding its lines. The time
+// series follows the intervals of the archive index when there is one (with their time spans when it
+// has them), and SUMMARY_INTERVAL_LINES lines otherwise.
+static void summarizeArchive()
+{
+    uint64_t wall_begin = XORC::traceWallNanos();
+
+    XORC::Mapped_File compressed_file(config.file_path);
+    if (XORC::is_framed_archive(compressed_file.data(), compressed_file.size()))
+    {
+        throw std::runtime_error("Summaries need an archive written by --compress.");
+    }
+    XORC::Bit_View compressed_bitset = XORC::view_bitset_in_file(compressed_file);
+
+    XORC::Archive_Index_Header index_header;
+    std::vector<XORC::Archive_Checkpoint> checkpoints;
+    std::error_code error;
+    const std::string index_path = std::string(config.file_path) + ".index";
+    if (std::filesystem::is_regular_file(index_path, error))
+    {
+        XORC::read_archive_index(index_path, index_header, checkpoints);
+    }
+
+    XORC::Stream_Summary summary;
+    size_t i = summary.read_stream_header(compressed_bitset);
+    size_t next_checkpoint = 0;
+    while (i < compressed_bitset.size())
+    {
+        if (next_checkpoint < checkpoints.size() && checkpoints[next_checkpoint].bit_offset <= i)
+        {
+            summary.begin_interval(checkpoints[next_checkpoint].min_time, checkpoints[next_checkpoint].max_time);
+            ++next_checkpoint;
+        }
+        else if (checkpoints.empty() && summary.interval_lines() >= SUMMARY_INTERVAL_LINES)
+        {
+            summary.begin_interval();
+        }
+        summary.summarize_next(compressed_bitset, i);
+    }
+
+    summary.write_json(std::cout);
+    std::cout << "Summary wall " << (XORC::traceWallNanos() - wall_begin) / 1e9 << " s" << std::endl;
+}
+
+// Runs config.thread_count producers over the lines of `lines`, each logging every
+// thread_count-th line through log_line, and reports the latency of the calls.
+template <typename Log_Line>
+static void runIngestProducers(const char *name, const XORC::Line_Index &lines, Log_Line log_line, std::function<void()> finish)
+{
+    const unsigned producer_count = config.thread_count;
+    std::vector<std::vector<uint32_t>> latencies(producer_count);
+    std::atomic<unsigned> ready{0};
+
+    auto produce = [&](unsigned t)
+    {
+        std::vector<uint32_t> &thread_latencies = latencies[t];
+        thread_latencies.reserve(lines.size() / producer_count + 1);
+        ready.fetch_add(1);
+        while (ready.load() < producer_count)
+        {
+        }
+        for (size_t j = t; j < lines.size(); j += producer_count)
+        {
+            uint64_t begin = XORC::traceWallNanos();
+            log_line(lines.line(j));
+            thread_latencies.push_back(static_cast<uint32_t>(std::min<uint64_t>(XORC::traceWallNanos() - begin, UINT32_MAX)));
+        }
+    };
+
+    uint64_t wall_begin = XORC::traceWallNanos();
+    std::vector<std::thread> producers;
+    for (unsigned t = 0; t < producer_count; ++t)
+    {
+        producers.emplace_back(produce, t);
+    }
+    for (std::thread &producer : producers)
+    {
+        producer.join();
+    }
+    uint64_t producers_done = XORC::traceWallNanos();
+    finish();
+    double wall_seconds = (XORC::traceWallNanos() - wall_begin) / 1e9;
+
+    std::vector<uint32_t> all;
+    for (const auto &thread_latencies : latencies)
+    {
+        all.insert(all.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p)
+    {
+        return all.empty() ? 0 : all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))];
+    };
+
+    std::cout << name << ": " << producer_count << " producers, enqueue latency ns p50 " << percentile(0.5)
+              << ", p99 " << percentile(0.99) << ", p99.9 " << percentile(0.999) << ", max " << (all.empty() ? 0 : all.back())
+              << "; producers done in " << (producers_done - wall_begin) / 1e9 << " s, all compressed in " << wall_seconds << " s" << std::endl;
+}
+
+// --ingest-bench: the lines of config.file_path logged by config.thread_count threads, once through
+// an Ingest_Compressor (framed archive at config.output_path) and once through a Stream_Compress
+// behind a mutex, the setup the queue replaces.
+static void benchmarkIngest()
+{
+    XORC::Mapped_File all_data(config.file_path);
+    XORC::Line_Index lines;
+    lines.build(all_data.data(), all_data.size(), config.thread_count);
+
+    const XORC::Stream_Options options = streamOptionsFromConfig();
+
+    XORC::Ingest_Options ingest_options;
+    ingest_options.queue_capacity = config.ingest_capacity;
+    ingest_options.overflow = config.overflow;
+    ingest_options.flush_bytes = config.flush_bytes;
+    ingest_options.flush_interval_ms = config.flush_interval_ms;
+    {
+        XORC::Ingest_Compressor ingest(config.output_path, options, ingest_options);
+        auto log_line = [&](std::string_view line)
+        {
+            ingest.log(line);
+        };
+        auto finish = [&]()
+        {
+            ingest.close();
+        };
+        runIngestProducers("Ingest queue", lines, log_line, finish);
+        std::cout << "Ingest queue: " << ingest.get_line_count() << " lines compressed into " << ingest.get_frame_count()
+                  << " frames, " << ingest.get_dropped() << " dropped, " << ingest.get_spilled() << " spilled" << std::endl;
+    }
+
+    std::mutex mutex;
+    XORC::Stream_Compress sc(options);
+    XORC::Output_Bitset output_data(2 * OUTPUT_CHUNK_SIZE * 8);
+    uint64_t len_output_data = 0;
+    auto log_line = [&](std::string_view line)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t max_record_bits = XORC::Stream_Compress::max_record_bits(line.size());
+        if (len_output_data + max_record_bits > output_data.size())
+        {
+            output_data.resize(2 * (len_output_data + max_record_bits));
+        }
+        sc.stream_compress(line, output_data, len_output_data);
+    };
+    runIngestProducers("Mutex", lines, log_line, []() {});
+}
+
+// --huge-page-bench: decodes the archive into one buffer the size of its text, the way the whole
+// output used to be reserved up front, once on small pages and once on huge pages, and reports
+// the time, dTLB misses and the pages each run got.
+static void benchmarkHugePages()
+{
+    XORC::Mapped_File compressed_file(config.file_path);
+    if (XORC::is_framed_archive(compressed_file.data(), compressed_file.size()))
+    {
+        throw std::runtime_error("The huge page benchmark needs an archive written by --compress.");
+    }
+    XORC::Bit_View compressed_bitset = XORC::view_bitset_in_file(compressed_file);
+
+    // calls add_line for every line of the archive, decoded by a fresh Line_Cursor
+    auto decode_archive = [&](const auto &add_line)
+    {
+        XORC::Line_Cursor cursor(compressed_bitset);
+        while (cursor.has_next())
+        {
+            add_line(cursor.next());
+        }
+    };
+
+    uint64_t len_raw_data = 0;
+    size_t line_count = 0;
+    auto count_line = [&](std::string_view line)
+    {
+        len_raw_data += line.size() + 1;
+        ++line_count;
+    };
+    decode_archive(count_line);
+
+    for (bool huge_pages : {false, true})
+    {
+        XORC::setHugePages(huge_pages);
+        char *decoded = static_cast<char *>(XORC::allocateHugePages(std::max<uint64_t>(len_raw_data, 1)));
+        size_t len_decoded = 0;
+        auto copy_line = [&](std::string_view line)
+        {
+            memcpy(decoded + len_decoded, line.data(), line.size());
+            decoded[len_decoded + line.size()] = '\n';
+            len_decoded += line.size() + 1;
+        };
+
+        XORC::Perf_Counters perf_counters;
+        uint64_t wall_begin = XORC::traceWallNanos();
+        perf_counters.start();
+        decode_archive(copy_line);
+        perf_counters.stop();
+        double wall_seconds = (XORC::traceWallNanos() - wall_begin) / 1e9;
+
+        std::cout << (huge_pages ? "Huge pages: " : "Small pages: ") << (double)(len_raw_data) / (1024 * 1024) / wall_seconds
+                  << " MB/s (wall " << wall_seconds << " s)" << std::endl;
+        perf_counters.write_report(std::cout, len_raw_data, line_count);
+        XORC::writeHugePageReport(std::cout);
+        XORC::freeHugePages(decoded);
+    }
+    XORC::setHugePages(config.huge_pages);
+}
+
+// --verify: checks every chunk of an archive against its checksum trailer, spread over
+// config.thread_count threads, without decoding anything. Returns the exit status: 0 if every
+// chunk matches, 1 on a mismatch or a damaged trailer, 2 if there are no checksums to check.
+static int verifyArchive()
+{
+    uint64_t wall_begin = XORC::traceWallNanos();
+
+    XORC::Mapped_File archive(config.file_path);
+    XORC::Checksum_Trailer trailer;
+    try
+    {
+        if (!XORC::read_checksum_trailer(archive.data(), archive.size(), trailer))
+        {
+            std::cerr << "The archive has no checksums, it was not written with --checksums." << std::endl;
+            return 2;
+        }
+    }
+    catch (const std::runtime_error &error)
+    {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    const size_t chunk_count = trailer.chunk_count();
+    std::vector<char> is_corrupt(chunk_count, 0);
+    auto verify_chunks = [&](size_t first, size_t last)
+    {
+        for (size_t chunk = first; chunk < last; ++chunk)
+        {
+            uint64_t begin = chunk * trailer.chunk_size;
+            uint64_t len_chunk = std::min<uint64_t>(trailer.chunk_size, trailer.len_data - begin);
+            is_corrupt[chunk] = XORC::crc32c(0, archive.data() + begin, len_chunk) != trailer.chunk_crc(chunk);
+        }
+    };
+
+    const size_t thread_count = std::max<size_t>(1, std::min<size_t>(config.thread_count, chunk_count));
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < thread_count; ++t)
+    {
+        workers.emplace_back(verify_chunks, chunk_count * t / thread_count, chunk_count * (t + 1) / thread_count);
+    }
+    verify_chunks(0, chunk_count / thread_count);
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    double wall_seconds = (XORC::traceWallNanos() - wall_begin) / 1e9;
+
+    size_t corrupt_count = 0;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk)
+    {
+        if (is_corrupt[chunk])
+        {
+            uint64_t begin = chunk * trailer.chunk_size;
+            std::cout << "Chunk " << chunk << " (bytes " << begin << " to " << std::min<uint64_t>(begin + trailer.chunk_size, trailer.len_data)
+                      << ") does not match its checksum" << std::endl;
+            ++corrupt_count;
+        }
+    }
+    std::cout << "Verified " << chunk_count << " chunks of " << trailer.chunk_size << " bytes, " << corrupt_count << " corrupt, "
+              << (double)(trailer.len_data) / (1024 * 1024) / wall_seconds << " MB/s (wall " << wall_seconds << " s, "
+              << thread_count << " threads)" << std::endl;
+    return corrupt_count == 0 ? 0 : 1;
+}
+
+// --estimate: the likely ratio, raw fallback share and line lengths of config.file_path, from about
+// config.sample_fraction of it, without writing anything.
+static void estimateFile()
+{
+    uint64_t wall_begin = XORC::traceWallNanos();
+
+    XORC::Sample_Estimator estimator(streamOptionsFromConfig());
+    estimator.sample_file(config.file_path, config.sample_fraction);
+    estimator.write_json(std::cout);
+    std::cout << "Estimate wall " << (XORC::traceWallNanos() - wall_begin) / 1e9 << " s" << std::endl;
+}
+
 int main(int argc, const char *argv[])
 {
     // Parse command line options
     parseOptions(argc, argv);
+    // before anything large is allocated
+    XORC::setHugePages(config.huge_pages);
+
+    if (config.timing || config.trace_path != nullptr)
+    {
+        XORC::enableTracing(config.trace_path != nullptr);
+    }
+
+    if (config.inputs_path != nullptr)
+    {
+        std::cout << "-----Compressing directory " << config.inputs_path << "-----" << std::endl;
+        std::cout << "Compressed output directory: " << config.output_path << std::endl;
+        compressDirectory();
+    }
+
+    if (config.follow_path != nullptr)
+    {
+        std::cout << "-----Following " << config.follow_path << "-----" << std::endl;
+        std::cout << "Compressed output file path: " << config.output_path << std::endl;
+        followFile();
+    }
+
+    const bool is_extract = config.since != nullptr || config.until != nullptr || config.grep != nullptr;
+    if (config.stream_decompress && is_extract)
+    {
+        std::cout << "-----Extracting from " << config.file_path << "-----" << std::endl;
+        extractFromIndex();
+    }
+
+    if (config.ingest_bench)
+    {
+        std::cout << "-----Ingest benchmark on " << config.file_path << "-----" << std::endl;
+        benchmarkIngest();
+    }
+
+    int exit_code = 0;
+    if (config.verify)
+    {
+        std::cout << "-----Verifying " << config.file_path << "-----" << std::endl;
+        exit_code = verifyArchive();
+    }
+
+    if (config.huge_page_bench)
+    {
+        std::cout << "-----Huge page benchmark on " << config.file_path << "-----" << std::endl;
+        benchmarkHugePages();
+    }
+
+    if (config.estimate)
+    {
+        std::cout << "-----Estimating " << config.file_path << "-----" << std::endl;
+        estimateFile();
+    }
+
+    if (config.summarize)
+    {
+        std::cout << "-----Summarizing " << config.file_path << "-----" << std::endl;
+        summarizeArchive();
+    }
 
     if (config.is_test)
     {
@@ -116,56 +1092,212 @@ int main(int argc, const char *argv[])
         std::cout << "Raw file path: " << config.file_path << std::endl;
         std::cout << "Compressed output file path: " << config.output_path << std::endl;
 
-        std::string all_data;
-        XORC::read_string_from_file(all_data, config.file_path);
+        uint64_t wall_begin = XORC::traceWallNanos();
+        clock_t cpu_begin = clock();
 
-        boost::dynamic_bitset<> output_data(all_data.size() * 8);
+        XORC::Scoped_Timer read_timer(XORC::TRACE_READ);
+        XORC::Mapped_File all_data(config.file_path);
+        read_timer.add_bytes(all_data.size());
+        read_timer.stop();
+
+        XORC::Output_Bitset output_data(2 * OUTPUT_CHUNK_SIZE * 8);
         uint64_t len_output_data = 0;
+        uint64_t len_drained_data = 0;
+
+        XORC::Scoped_Timer split_timer(XORC::TRACE_SPLIT, all_data.size());
+        XORC::Line_Index split_all_data;
+        split_all_data.build(all_data.data(), all_data.size(), config.thread_count);
+        split_timer.stop();
+
+        std::error_code index_error;
+        const bool is_appending = config.append && std::filesystem::is_regular_file(config.output_path, index_error) &&
+                                  std::filesystem::file_size(config.output_path, index_error) > 0;
+        // with a timestamp format or trigram filters, a checkpoint (window snapshot, time span,
+        // filter) is taken at the first batch boundary after every checkpoint_lines lines. Set up
+        // before the archive is resumed, so an index mismatch leaves the archive untouched.
+        std::unique_ptr<XORC::Timestamp_Format> timestamp_format;
+        std::unique_ptr<XORC::Trigram_Filter_Builder> trigram_filter;
+        std::unique_ptr<XORC::Archive_Index_Writer> archive_index;
+        XORC::Archive_Checkpoint checkpoint;
+        int64_t current_time = std::numeric_limits<int64_t>::min();
+        size_t checkpoint_line_count = 0;
+        if (config.timestamp_format != nullptr || config.trigram_filters)
+        {
+            XORC::Archive_Index_Header index_header;
+            if (config.timestamp_format != nullptr)
+            {
+                timestamp_format.reset(new XORC::Timestamp_Format(config.timestamp_format));
+                index_header.timestamp_format = config.timestamp_format;
+            }
+            if (config.trigram_filters)
+            {
+                trigram_filter.reset(new XORC::Trigram_Filter_Builder());
+                index_header.trigram_filters = true;
+            }
+            archive_index.reset(new XORC::Archive_Index_Writer(std::string(config.output_path) + ".index", index_header, is_appending));
+        }
+        else if (is_appending && std::filesystem::exists(std::string(config.output_path) + ".index"))
+        {
+            throw std::runtime_error("Appending needs the archive index options the archive was started with.");
+        }
+        if (is_appending && !config.checksums)
+        {
+            XORC::Mapped_File archive(config.output_path);
+            XORC::Checksum_Trailer trailer;
+            if (XORC::read_checksum_trailer(archive.data(), archive.size(), trailer))
+            {
+                throw std::runtime_error("Appending needs --checksums, the archive was started with it.");
+            }
+        }
 
-        std::vector<std::string> split_all_data;
+        XORC::Stream_Compress *sc = new XORC::Stream_Compress(streamOptionsFromConfig());
+        bool is_resumed = config.append && resumeArchive(*sc, output_data, len_output_data, len_drained_data);
+        uint64_t len_resumed_data = len_drained_data / 8;
+        if (!is_resumed)
+        {
+            sc->write_stream_header(output_data, len_output_data);
+        }
+
+        XORC::Output_Sink sink(config.output_path, config.direct_io, is_resumed);
+        if (config.checksums)
+        {
+            sink.enable_checksums();
+        }
 
-        std::istringstream stream(all_data);
-        std::string token;
+        std::unique_ptr<XORC::Perf_Counters> perf_counters;
+        if (config.perf_counters)
+        {
+            perf_counters.reset(new XORC::Perf_Counters());
+            perf_counters->start();
+        }
 
-        int line_count = 0;
-        while (std::getline(stream, token, '\n'))
+        auto close_checkpoint = [&]()
         {
-            if (!token.empty() && token.back() == '\r')
+            if (trigram_filter)
             {
-                token.pop_back();
+                trigram_filter->build(config.false_positive_rate, checkpoint.trigram_filter);
+            }
+            archive_index->add(checkpoint);
+        };
+
+        // an appended archive keeps the block size it was started with
+        const size_t reorder_block = sc->get_reorder_block();
+        const size_t batch_lines = reorder_block ? reorder_block : COMPRESS_BATCH_LINES;
+        std::vector<std::string_view> batch;
+        batch.reserve(batch_lines);
+        for (size_t i = 0; i < split_all_data.size(); i += batch_lines)
+        {
+            batch.clear();
+            for (size_t j = i; j < std::min(i + batch_lines, split_all_data.size()); ++j)
+            {
+                batch.push_back(split_all_data.line(j));
+            }
+
+            if (archive_index)
+            {
+                if (i == 0 || checkpoint_line_count >= config.checkpoint_lines)
+                {
+                    if (i > 0)
+                    {
+                        close_checkpoint();
+                    }
+                    checkpoint = XORC::Archive_Checkpoint();
+                    checkpoint.bit_offset = len_drained_data + len_output_data;
+                    checkpoint.initial_time = current_time;
+                    sc->save_window(checkpoint.window);
+                    checkpoint_line_count = 0;
+                }
+                for (std::string_view line : batch)
+                {
+                    int64_t line_time;
+                    if (timestamp_format && timestamp_format->parse(line, line_time))
+                    {
+                        current_time = line_time;
+                    }
+                    if (current_time != std::numeric_limits<int64_t>::min())
+                    {
+                        checkpoint.min_time = std::min(checkpoint.min_time, current_time);
+                        checkpoint.max_time = std::max(checkpoint.max_time, current_time);
+                    }
+                    if (trigram_filter)
+                    {
+                        trigram_filter->add(line);
+                    }
+                }
+                checkpoint_line_count += batch.size();
+            }
+
+            if (reorder_block)
+            {
+                sc->stream_compress_block(batch.data(), batch.size(), output_data, len_output_data);
+            }
+            else
+            {
+                sc->stream_compress_batch(batch.data(), batch.size(), output_data, len_output_data);
+            }
+
+            if (len_output_data >= OUTPUT_CHUNK_SIZE * 8)
+            {
+                len_drained_data += len_output_data;
+                sink.drain(output_data, len_output_data);
+                len_drained_data -= len_output_data;
             }
-            split_all_data.push_back(token);
-            ++line_count;
         }
 
-        XORC::Stream_Compress *sc = new XORC::Stream_Compress();
+        if (perf_counters)
+        {
+            perf_counters->stop();
+        }
+        if (archive_index && split_all_data.size() > 0)
+        {
+            close_checkpoint();
+        }
 
-        clock_t start_time, end_time;
-        start_time = clock();
-        for (size_t i = 0; i < split_all_data.size(); ++i)
+        sink.finish(output_data, len_output_data, len_drained_data + len_output_data);
+        if (config.append)
         {
-            sc->stream_compress(split_all_data[i], output_data, len_output_data);
+            saveWindowSnapshot(*sc, len_drained_data + len_output_data);
         }
-        end_time = clock();
 
-        output_data.resize(len_output_data);
-        XORC::write_bitset_to_file(output_data, config.output_path);
+        double wall_seconds = (XORC::traceWallNanos() - wall_begin) / 1e9;
+        double cpu_seconds = static_cast<double>(clock() - cpu_begin) / CLOCKS_PER_SEC;
 
         int64_t raw_size = file_size(config.file_path);
-        int64_t compressed_size = file_size(config.output_path);
+        int64_t compressed_size = static_cast<int64_t>(file_size(config.output_path)) - len_resumed_data;
         std::cout << "Compression rate (with separator): "
                   << static_cast<double>(compressed_size) / static_cast<double>(raw_size)
                   << std::endl;
 
         std::cout << "Compression speed: "
-                  << (double)(raw_size) / 8 / (1024 * 1024) /
-                         ((double)(end_time - start_time) / CLOCKS_PER_SEC)
-                  << " MB/s" << std::endl;
+                  << (double)(raw_size) / (1024 * 1024) / wall_seconds
+                  << " MB/s (wall " << wall_seconds << " s, cpu " << cpu_seconds << " s)" << std::endl;
+
+        if (config.timing)
+        {
+            XORC::writeTraceReport(std::cout);
+        }
+
+        if (perf_counters)
+        {
+            perf_counters->write_report(std::cout, all_data.size(), split_all_data.size());
+        }
+
+        if (config.huge_pages)
+        {
+            XORC::writeHugePageReport(std::cout);
+        }
+
+#ifdef XORC_STATS
+        if (config.stats)
+        {
+            sc->get_stats().write_json(std::cout);
+        }
+#endif
 
         delete sc;
     }
 
-    if (config.stream_decompress || config.is_test)
+    if ((config.stream_decompress || config.is_test) && !is_extract)
     {
         if (config.is_test)
         {
@@ -176,102 +1308,110 @@ int main(int argc, const char *argv[])
         std::cout << "Compressed file path: " << config.file_path << std::endl;
         std::cout << "Decompressed output file path: " << config.output_path << std::endl;
 
-        boost::dynamic_bitset<> compressed_bitset;
-        XORC::read_bitset_from_file(compressed_bitset, config.file_path);
-
-        std::vector<boost::dynamic_bitset<>> split_compressed_bitset;
-        std::vector<bool> isRLE;
-        std::vector<int> original_length_or_window_id;
-        size_t len_compressed_bitset = compressed_bitset.size();
-        size_t i = 0;
-        while (i < len_compressed_bitset)
+        uint64_t wall_begin = XORC::traceWallNanos();
+        clock_t cpu_begin = clock();
+
+        XORC::Scoped_Timer read_timer(XORC::TRACE_READ);
+        XORC::Mapped_File compressed_file(config.file_path);
+        // a framed archive is decoded up to its last complete frame
+        bool is_framed = XORC::is_framed_archive(compressed_file.data(), compressed_file.size());
+        size_t len_frame_begin = 0;
+        size_t len_frame_end = 0;
+        XORC::Bit_View compressed_bitset;
+        if (is_framed)
         {
-            if (compressed_bitset[i] == 0)
-            {
-                isRLE.push_back(false);
-                i++;
+            XORC::read_frame(compressed_file.data(), compressed_file.size(), len_frame_end, compressed_bitset);
+            len_frame_begin = 2 * sizeof(uint64_t);
+        }
+        else
+        {
+            compressed_bitset = XORC::view_bitset_in_file(compressed_file);
+        }
+        read_timer.add_bytes(compressed_file.size());
+        read_timer.stop();
 
-                int tem_original_length = 0;
-                for (size_t j = 0; j < ORIGINAL_LENGTH_COUNT; ++j, ++i)
-                {
-                    if (compressed_bitset[i])
-                    {
-                        tem_original_length |= (1 << j);
-                    }
-                }
-                original_length_or_window_id.push_back(tem_original_length);
+        XORC::Line_Cursor cursor(compressed_bitset);
 
-                boost::dynamic_bitset<> tem_bitset(tem_original_length * 8);
-                for (size_t j = 0; j < tem_original_length * 8; j++)
-                {
-                    tem_bitset[j] = compressed_bitset[i + j];
-                }
-                i += tem_original_length * 8;
+        XORC::Output_Sink sink(config.output_path);
 
-                split_compressed_bitset.push_back(tem_bitset);
-            }
-            else
+        std::string all_data;
+        all_data.reserve(OUTPUT_CHUNK_SIZE + MAX_LEN);
+
+        uint64_t len_raw_data = 0;
+        size_t len_released_data = 0;
+
+        std::unique_ptr<XORC::Perf_Counters> perf_counters;
+        if (config.perf_counters)
+        {
+            perf_counters.reset(new XORC::Perf_Counters());
+            perf_counters->start();
+        }
+
+        while (true)
+        {
+            while (cursor.has_next())
             {
-                isRLE.push_back(true);
-                i++;
-                int tem_window_id = 0;
-                for (size_t j = 0; j < EACH_WINDOW_SIZE_COUNT; ++j, ++i)
-                {
-                    if (compressed_bitset[i])
-                    {
-                        tem_window_id |= (1 << j);
-                    }
-                }
-                original_length_or_window_id.push_back(tem_window_id);
+                all_data += cursor.next();
+                all_data += "\n";
 
-                int len_single_data = 0;
-                for (size_t j = 0; j < STREAM_ENCODER_COUNT; ++j, ++i)
+                if (all_data.size() >= OUTPUT_CHUNK_SIZE)
                 {
-                    if (compressed_bitset[i])
+                    len_raw_data += all_data.size();
+                    sink.write(all_data.data(), all_data.size());
+                    all_data.clear();
+
+                    if (len_frame_begin + cursor.position() / 8 >= len_released_data + OUTPUT_CHUNK_SIZE)
                     {
-                        len_single_data |= (1 << j);
+                        len_released_data = len_frame_begin + cursor.position() / 8;
+                        compressed_file.release(len_released_data);
                     }
                 }
-
-                boost::dynamic_bitset<> tem_bitset(len_single_data);
-                for (size_t j = 0; j < len_single_data; j++)
-                {
-                    tem_bitset[j] = compressed_bitset[i + j];
-                }
-                i += len_single_data;
-
-                split_compressed_bitset.push_back(tem_bitset);
             }
+            len_frame_begin = len_frame_end + 2 * sizeof(uint64_t);
+            if (!is_framed || !XORC::read_frame(compressed_file.data(), compressed_file.size(), len_frame_end, compressed_bitset))
+            {
+                break;
+            }
+            cursor.next_frame(compressed_bitset);
+        }
+        if (perf_counters)
+        {
+            perf_counters->stop();
         }
 
-        std::string all_data;
-        all_data.reserve(static_cast<size_t>(1024) * 1024 * 1024 * 33);
+        len_raw_data += all_data.size();
+        sink.write(all_data.data(), all_data.size());
+        sink.flush();
 
-        XORC::Stream_Compress *sc = new XORC::Stream_Compress();
+        double wall_seconds = (XORC::traceWallNanos() - wall_begin) / 1e9;
+        double cpu_seconds = static_cast<double>(clock() - cpu_begin) / CLOCKS_PER_SEC;
 
-        std::string xor_result;
-        xor_result.reserve(500);
+        std::cout << "Decompression speed: "
+                  << (double)(len_raw_data) / (1024 * 1024) / wall_seconds
+                  << " MB/s (wall " << wall_seconds << " s, cpu " << cpu_seconds << " s)" << std::endl;
 
-        clock_t start_time, end_time;
-        start_time = clock();
-        for (size_t i = 0; i < split_compressed_bitset.size(); ++i)
+        if (config.timing)
         {
-            sc->stream_decompress(split_compressed_bitset[i], isRLE[i], original_length_or_window_id[i], all_data, xor_result);
+            XORC::writeTraceReport(std::cout);
         }
-        end_time = clock();
 
-        XORC::write_string_to_file(all_data, config.output_path);
+        if (perf_counters)
+        {
+            perf_counters->write_report(std::cout, len_raw_data, cursor.lines_read());
+        }
 
-        int64_t raw_size = static_cast<int64_t>(file_size(config.output_path)) - 2 * split_compressed_bitset.size();
-        std::cout << "Decompression speed: "
-                  << (double)(raw_size) / (1024 * 1024) /
-                         ((double)(end_time - start_time) / CLOCKS_PER_SEC)
-                  << " MB/s" << std::endl;
+        if (config.huge_pages)
+        {
+            XORC::writeHugePageReport(std::cout);
+        }
+    }
 
-        delete sc;
+    if (config.trace_path != nullptr)
+    {
+        XORC::writeChromeTrace(config.trace_path);
     }
 
-    return 0;
+    return exit_code;
 }
 
 